@@ -5,8 +5,22 @@ fail() {
     exit 1
 }
 
+# concurrent steps still running on exit, e.g. after a sibling step failed, are stopped so that
+# they do not keep writing into TMP_PATH or the step cache. Their partial outputs have no .dbtype
+# file and are computed again by the next run.
+BG_PIDS=""
+stopBackground() {
+    for PID in $BG_PIDS; do
+        kill "$PID" 2>/dev/null || true
+        wait "$PID" 2>/dev/null || true
+    done
+    unlockSteps
+}
+trap stopBackground EXIT
+
+# outputs in the step cache are kept for later runs
 deleteIncremental() {
-    if [ -n "$REMOVE_INCREMENTAL_TMP" ] &&  [ -n "$1" ]; then
+    if [ -n "$REMOVE_INCREMENTAL_TMP" ] && [ -z "$CACHE_PATH" ] && [ -n "$1" ]; then
          "$MMSEQS" rmdb "$1"
     fi
 }
@@ -15,6 +29,50 @@ notExists() {
 	[ ! -f "$1" ]
 }
 
+# extractorfs writes the ORFs $1 and their headers, the .dbtype files mark both as complete
+orfsNotExist() {
+    notExists "$1.dbtype" || notExists "$1_h.dbtype"
+}
+
+# locks the step directory $1 until this run exits, runs that share a step key wait for each other
+# and then reuse the finished outputs. The lock of a run that no longer exists is taken over.
+lockStep() {
+    while ! mkdir "$1.lock" 2>/dev/null; do
+        LOCK_PID="$(cat "$1.lock/pid" 2>/dev/null || true)"
+        if [ "$LOCK_PID" = "$$" ]; then
+            return
+        fi
+        if [ -n "$LOCK_PID" ] && ! kill -0 "$LOCK_PID" 2>/dev/null; then
+            rm -rf "$1.lock"
+        else
+            sleep 1
+        fi
+    done
+    echo "$$" > "$1.lock/pid"
+}
+
+unlockSteps() {
+    if [ -n "$CACHE_PATH" ]; then
+        for LOCK in "${CACHE_PATH}"/*.lock; do
+            if [ "$(cat "$LOCK/pid" 2>/dev/null || true)" = "$$" ]; then
+                rm -rf "$LOCK"
+            fi
+        done
+    fi
+}
+
+# directory of the step whose key is in the variable $1, steps without step cache write to TMP_PATH
+stepPath() {
+    if [ -n "$CACHE_PATH" ]; then
+        eval STEP_KEY="\$$1"
+        mkdir -p "${CACHE_PATH}/${STEP_KEY}"
+        lockStep "${CACHE_PATH}/${STEP_KEY}"
+        echo "${CACHE_PATH}/${STEP_KEY}"
+    else
+        echo "${TMP_PATH}"
+    fi
+}
+
 # check input variables
 [ -z "${OUT_FILE}" ] && echo "Please provide OUT_FILE" && exit 1
 [ -z "${TMP_PATH}" ] && echo "Please provide TMP_PATH" && exit 1
@@ -26,45 +84,86 @@ notExists() {
 
 
 INPUT="$1"
-if notExists "${TMP_PATH}/nucl_6f_start"; then
-    # shellcheck disable=SC2086
-    "$MMSEQS" extractorfs "${INPUT}" "${TMP_PATH}/nucl_6f_start" ${EXTRACTORFS_START_PAR} \
-        || fail "extractorfs start step died"
-fi
+# readorfs already wrote the translated ORFs of the reads
+if [ -n "${ORF_INPUT}" ]; then
+    ORFS="$1"
+else
+    ORF_PATH="$(stepPath ORFS_KEY)"
+    # the start and long ORFs are independent and are extracted and translated concurrently,
+    # each with half of the threads if both have to be computed
+    START_PAR="${EXTRACTORFS_START_PAR}"
+    LONG_PAR="${EXTRACTORFS_LONG_PAR}"
+    if orfsNotExist "${ORF_PATH}/nucl_6f_start" && orfsNotExist "${ORF_PATH}/nucl_6f_long"; then
+        START_PAR="${EXTRACTORFS_START_HALF_PAR}"
+        LONG_PAR="${EXTRACTORFS_LONG_HALF_PAR}"
+    fi
+    START_PID=""
+    if orfsNotExist "${ORF_PATH}/nucl_6f_start"; then
+        # shellcheck disable=SC2086
+        "$MMSEQS" extractorfs "${INPUT}" "${ORF_PATH}/nucl_6f_start" ${START_PAR} &
+        START_PID=$!
+        BG_PIDS="$BG_PIDS $START_PID"
+    fi
 
-if notExists "${TMP_PATH}/aa_6f_start"; then
-    # shellcheck disable=SC2086
-    "$MMSEQS" translatenucs "${TMP_PATH}/nucl_6f_start" "${TMP_PATH}/aa_6f_start" ${TRANSLATENUCS_PAR} \
-        || fail "translatenucs start step died"
-fi
+    if orfsNotExist "${ORF_PATH}/nucl_6f_long"; then
+        # shellcheck disable=SC2086
+        "$MMSEQS" extractorfs "${INPUT}" "${ORF_PATH}/nucl_6f_long" ${LONG_PAR} \
+            || fail "extractorfs long step died"
+    fi
 
-if notExists "${TMP_PATH}/nucl_6f_long"; then
-    # shellcheck disable=SC2086
-    "$MMSEQS" extractorfs "${INPUT}" "${TMP_PATH}/nucl_6f_long" ${EXTRACTORFS_LONG_PAR} \
-        || fail "extractorfs longest step died"
-fi
+    if [ -n "$START_PID" ]; then
+        wait "$START_PID" || fail "extractorfs start step died"
+    fi
+    BG_PIDS=""
 
-if notExists "${TMP_PATH}/aa_6f_long"; then
-    # shellcheck disable=SC2086
-    "$MMSEQS" translatenucs "${TMP_PATH}/nucl_6f_long" "${TMP_PATH}/aa_6f_long" ${TRANSLATENUCS_PAR} \
-        || fail "translatenucs long step died"
-fi
+    TRANSLATE_PAR="${TRANSLATENUCS_PAR}"
+    if notExists "${ORF_PATH}/aa_6f_start.dbtype" && notExists "${ORF_PATH}/aa_6f_long.dbtype"; then
+        TRANSLATE_PAR="${TRANSLATENUCS_HALF_PAR}"
+    fi
+    START_PID=""
+    if notExists "${ORF_PATH}/aa_6f_start.dbtype"; then
+        # shellcheck disable=SC2086
+        "$MMSEQS" translatenucs "${ORF_PATH}/nucl_6f_start" "${ORF_PATH}/aa_6f_start" ${TRANSLATE_PAR} &
+        START_PID=$!
+        BG_PIDS="$BG_PIDS $START_PID"
+    fi
 
-if notExists "${TMP_PATH}/aa_6f_start_long"; then
-    # shellcheck disable=SC2086
-    "$MMSEQS" concatdbs "${TMP_PATH}/aa_6f_long" "${TMP_PATH}/aa_6f_start" "${TMP_PATH}/aa_6f_start_long" ${VERBOSITY_PAR} \
-        || fail "concatdbs start long step died"
-fi
+    if notExists "${ORF_PATH}/aa_6f_long.dbtype"; then
+        # shellcheck disable=SC2086
+        "$MMSEQS" translatenucs "${ORF_PATH}/nucl_6f_long" "${ORF_PATH}/aa_6f_long" ${TRANSLATE_PAR} \
+            || fail "translatenucs long step died"
+    fi
 
-if notExists "${TMP_PATH}/aa_6f_start_long_h"; then
-    #awk 'BEGIN { printf("%c%c%c%c",12,0,0,0); exit; }' > "${TMP_PATH}/nucl_6f_long_h.dbtype"
-    #awk 'BEGIN { printf("%c%c%c%c",12,0,0,0); exit; }' > "${TMP_PATH}/nucl_6f_start_h.dbtype"
-    # shellcheck disable=SC2086
-    "$MMSEQS" concatdbs "${TMP_PATH}/nucl_6f_long_h" "${TMP_PATH}/nucl_6f_start_h" "${TMP_PATH}/aa_6f_start_long_h" ${VERBOSITY_PAR} \
-        || fail "concatdbs start long step died"
+    if [ -n "$START_PID" ]; then
+        wait "$START_PID" || fail "translatenucs start step died"
+    fi
+    BG_PIDS=""
+
+    # link instead of copying the ORFs, aa_6f_long and aa_6f_start have to be kept until the end
+    CONCAT_PID=""
+    if notExists "${ORF_PATH}/aa_6f_start_long.dbtype"; then
+        # shellcheck disable=SC2086
+        "$MMSEQS" virtualconcatdbs "${ORF_PATH}/aa_6f_long" "${ORF_PATH}/aa_6f_start" "${ORF_PATH}/aa_6f_start_long" ${VERBOSITY_PAR} &
+        CONCAT_PID=$!
+        BG_PIDS="$BG_PIDS $CONCAT_PID"
+    fi
+
+    if notExists "${ORF_PATH}/aa_6f_start_long_h.dbtype"; then
+        #awk 'BEGIN { printf("%c%c%c%c",12,0,0,0); exit; }' > "${ORF_PATH}/nucl_6f_long_h.dbtype"
+        #awk 'BEGIN { printf("%c%c%c%c",12,0,0,0); exit; }' > "${ORF_PATH}/nucl_6f_start_h.dbtype"
+        # shellcheck disable=SC2086
+        "$MMSEQS" virtualconcatdbs "${ORF_PATH}/nucl_6f_long_h" "${ORF_PATH}/nucl_6f_start_h" "${ORF_PATH}/aa_6f_start_long_h" ${VERBOSITY_PAR} \
+            || fail "concatdbs start long header step died"
+    fi
+
+    if [ -n "$CONCAT_PID" ]; then
+        wait "$CONCAT_PID" || fail "concatdbs start long step died"
+    fi
+    BG_PIDS=""
+    ORFS="${ORF_PATH}/aa_6f_start_long"
 fi
 
-INPUT="${TMP_PATH}/aa_6f_start_long"
+INPUT="${ORFS}"
 STEP=0
 if [ -z "$NUM_IT" ]; then
     NUM_IT=1
@@ -72,104 +171,110 @@ fi
 
 while [ "$STEP" -lt "$NUM_IT" ]; do
     echo "STEP: $STEP"
+    PREF_PATH="$(stepPath "PREF${STEP}_KEY")"
+    ALN_PATH="$(stepPath "ALN${STEP}_KEY")"
+    ASSEMBLY_PATH="$(stepPath "ASSEMBLY${STEP}_KEY")"
     # 1. Finding exact $k$-mer matches.
-    if notExists "${TMP_PATH}/pref_$STEP.done"; then
+    if notExists "${PREF_PATH}/pref_$STEP.done"; then
         PARAM=KMERMATCHER${STEP}_PAR
         eval KMERMATCHER_TMP="\$$PARAM"
+        # only k-mers near the ends of long contigs can start an extending overlap
+        KMER_INPUT="$INPUT"
+        PARAM=END_WINDOW${STEP}
+        eval END_WINDOW_TMP="\$$PARAM"
+        if [ -n "$END_WINDOW_TMP" ]; then
+            if notExists "${PREF_PATH}/kmer_ends_$STEP.dbtype"; then
+                # shellcheck disable=SC2086
+                "$MMSEQS" maskinterior "$INPUT" "${PREF_PATH}/kmer_ends_$STEP" ${MASKINTERIOR_PAR} \
+                    || fail "Mask interior step died"
+            fi
+            KMER_INPUT="${PREF_PATH}/kmer_ends_$STEP"
+        fi
         # shellcheck disable=SC2086
-        $RUNNER "$MMSEQS" kmermatcher "$INPUT" "${TMP_PATH}/pref_$STEP" ${KMERMATCHER_TMP} \
+        $RUNNER "$MMSEQS" kmermatcher "$KMER_INPUT" "${PREF_PATH}/pref_$STEP" ${KMERMATCHER_TMP} \
             || fail "Kmer matching step died"
+        if [ -n "$END_WINDOW_TMP" ]; then
+            deleteIncremental "${PREF_PATH}/kmer_ends_$STEP"
+        fi
         deleteIncremental "$PREV_KMER_PREF"
-        touch "${TMP_PATH}/pref_$STEP.done"
-        PREV_KMER_PREF="${TMP_PATH}/pref_$STEP"
+        touch "${PREF_PATH}/pref_$STEP.done"
+        PREV_KMER_PREF="${PREF_PATH}/pref_$STEP"
 
     fi
 
     # 2. Ungapped alignment
-    if notExists "${TMP_PATH}/aln_$STEP.done"; then
+    PARAM=UNGAPPED_ALN${STEP}_PAR
+    eval UNGAPPED_ALN_TMP="\$$PARAM"
+    if notExists "${ALN_PATH}/aln_$STEP.done"; then
         # shellcheck disable=SC2086
-        $RUNNER "$MMSEQS" rescorediagonal "$INPUT" "$INPUT" "${TMP_PATH}/pref_$STEP" "${TMP_PATH}/aln_$STEP" ${UNGAPPED_ALN_PAR} \
+        $RUNNER "$MMSEQS" rescorediagonal "$INPUT" "$INPUT" "${PREF_PATH}/pref_$STEP" "${ALN_PATH}/aln_$STEP" ${UNGAPPED_ALN_TMP} \
             || fail "Ungapped alignment step died"
-        touch "${TMP_PATH}/aln_$STEP.done"
+        touch "${ALN_PATH}/aln_$STEP.done"
         deleteIncremental "$PREV_ALN"
-        PREV_ALN="${TMP_PATH}/aln_$STEP"
+        PREV_ALN="${ALN_PATH}/aln_$STEP"
     fi
 
-    ALN="${TMP_PATH}/aln_$STEP"
+    ALN="${ALN_PATH}/aln_$STEP"
     if [ $STEP -eq 0 ]; then
-        if notExists "${TMP_PATH}/corrected_seqs.done"; then
+        CORRECTED_PATH="$(stepPath CORRECTED_KEY)"
+        # findassemblystart also shifts the alignments to the corrected sequences, so
+        # they do not have to be prefiltered and aligned again
+        if notExists "${CORRECTED_PATH}/corrected_seqs.done"; then
             # shellcheck disable=SC2086
-            "$MMSEQS" findassemblystart "$INPUT" "${TMP_PATH}/aln_$STEP" "${TMP_PATH}/corrected_seqs" ${THREADS_PAR} \
+            "$MMSEQS" findassemblystart "$INPUT" "${ALN_PATH}/aln_$STEP" "${CORRECTED_PATH}/corrected_seqs" "${CORRECTED_PATH}/aln_corrected_$STEP" ${UNGAPPED_ALN_TMP} \
                 || fail "Findassemblystart alignment step died"
-              touch "${TMP_PATH}/corrected_seqs.done"
+              touch "${CORRECTED_PATH}/corrected_seqs.done"
               # delete at the end of the first iteration
-              PREV_ASSEMBLY="${TMP_PATH}/corrected_seqs"
-        fi
-        INPUT="${TMP_PATH}/corrected_seqs"
-
-        if notExists "${TMP_PATH}/pref_corrected_$STEP.done"; then
-            # shellcheck disable=SC2086
-            $RUNNER "$MMSEQS" kmermatcher "$INPUT" "${TMP_PATH}/pref_corrected_$STEP" ${KMERMATCHER_TMP} \
-                || fail "Kmer matching step died"
-            deleteIncremental "$PREV_KMER_PREF"
-            touch "${TMP_PATH}/pref_corrected_$STEP.done"
-            PREV_KMER_PREF="${TMP_PATH}/pref_corrected_$STEP"
-        fi
-
-        if notExists "${TMP_PATH}/aln_corrected_$STEP.done"; then
-            # shellcheck disable=SC2086
-            $RUNNER "$MMSEQS" rescorediagonal "$INPUT" "$INPUT" "${TMP_PATH}/pref_corrected_$STEP" "${TMP_PATH}/aln_corrected_$STEP" ${UNGAPPED_ALN_PAR} \
-                || fail "Ungapped alignment step died"
-           touch "${TMP_PATH}/aln_corrected_$STEP.done"
-           deleteIncremental "$PREV_ALN"
-           PREV_ALN="${TMP_PATH}/aln_corrected_$STEP"
+              PREV_ASSEMBLY="${CORRECTED_PATH}/corrected_seqs"
+              deleteIncremental "$PREV_ALN"
+              PREV_ALN="${CORRECTED_PATH}/aln_corrected_$STEP"
         fi
-        ALN="${TMP_PATH}/aln_corrected_$STEP"
+        INPUT="${CORRECTED_PATH}/corrected_seqs"
+        ALN="${CORRECTED_PATH}/aln_corrected_$STEP"
     fi
 
     # 3. Assemble
-    if notExists "${TMP_PATH}/assembly_$STEP.done"; then
+    if notExists "${ASSEMBLY_PATH}/assembly_$STEP.done"; then
+        PARAM=ASSEMBLE_RESULT${STEP}_PAR
+        eval ASSEMBLE_RESULT_TMP="\$$PARAM"
         # shellcheck disable=SC2086
-        "$MMSEQS" assembleresults "$INPUT" "${ALN}" "${TMP_PATH}/assembly_$STEP" ${ASSEMBLE_RESULT_PAR} \
+        "$MMSEQS" assembleresults "$INPUT" "${ALN}" "${ASSEMBLY_PATH}/assembly_$STEP" ${ASSEMBLE_RESULT_TMP} \
             || fail "Assembly step died"
 
-        touch "${TMP_PATH}/assembly_$STEP.done"
+        touch "${ASSEMBLY_PATH}/assembly_$STEP.done"
         deleteIncremental "$PREV_ASSEMBLY"
-        PREV_ASSEMBLY="${TMP_PATH}/assembly_$STEP"
+        PREV_ASSEMBLY="${ASSEMBLY_PATH}/assembly_$STEP"
     fi
 
-    INPUT="${TMP_PATH}/assembly_$STEP"
+    INPUT="${ASSEMBLY_PATH}/assembly_$STEP"
+    # skip the remaining iterations once one barely grows the assembly, the last one still runs its protein filter
+    if [ -f "${ASSEMBLY_PATH}/assembly_$STEP.converged" ] && [ "$STEP" -lt "$((NUM_IT-2))" ]; then
+        echo "Converged after step $STEP"
+        STEP="$((NUM_IT-2))"
+    fi
     STEP="$((STEP+1))"
 
 done
 STEP="$((STEP-1))"
 
 # post processing
-RESULT="${TMP_PATH}/assembly_${STEP}"
-if [ -n "${PROTEIN_FILTER}" ]; then
-    RESULT="${TMP_PATH}/assembly_${STEP}_filtered"
-    if notExists "${TMP_PATH}/assembly_${STEP}_filtered"; then
-        # shellcheck disable=SC2086
-        "$MMSEQS" filternoncoding "${TMP_PATH}/assembly_${STEP}" "${TMP_PATH}/assembly_${STEP}_filtered" ${FILTERNONCODING_PAR} \
-            || fail "filternoncoding died"
-    fi
-fi
+# the last assembleresults iteration already removed non-coding entries if the protein filter is enabled
+RESULT="${ASSEMBLY_PATH}/assembly_${STEP}"
+# selections depend on all parameters, they are never written to the step cache
+SELECTED="${TMP_PATH}/assembly_${STEP}_only_assembled.index"
 
 # select only assembled sequences
-if notExists "${RESULT}_only_assembled.index"; then
-    # detect assembled proteins sequences
-    awk 'NR == FNR { f[$1] = $0; next } $1 in f { print f[$1], $0 }' "${RESULT}.index" "${TMP_PATH}/aa_6f_start_long.index" > "${RESULT}_tmp.index"
-    awk '$3 > $6 { print $1"\t"$2"\t"$3 }' "${RESULT}_tmp.index" > "${RESULT}_only_assembled1.index"
-    # detect complete proteins with * at start and end
-    awk '/^\x00?\*[A-Z]*\*$/{ f[NR-1]=1; next } $1 in f { print $0 }' "${RESULT}" "${RESULT}.index" > "${RESULT}_only_assembled2.index"
-    # keep only non-redundant entries
-    cat "${RESULT}_only_assembled1.index" "${RESULT}_only_assembled2.index" | sort | uniq > "${RESULT}_only_assembled.index"
+if notExists "${SELECTED}"; then
+    # assembled proteins grew beyond their ORF, complete proteins have a * at start and end
+    # shellcheck disable=SC2086
+    "$MMSEQS" selectentries "${RESULT}" "${SELECTED}" --grown-from "${ORFS}" --complete-orf 1 --match-any 1 ${THREADS_PAR} \
+        || fail "Select assembled sequences died"
 fi
 
 # create db outfile
 if notExists "${OUT_FILE}.dbtype"; then
      # shellcheck disable=SC2086
-    "$MMSEQS" createsubdb "${RESULT}_only_assembled.index" "${RESULT}" "${OUT_FILE}" --subdb-mode 0 \
+    "$MMSEQS" createsubdb "${SELECTED}" "${RESULT}" "${OUT_FILE}" --subdb-mode 0 \
         || fail "Createsubdb died"
 fi
 
@@ -178,6 +283,7 @@ if [ -n "$REMOVE_TMP" ]; then
     rm -f "${TMP_PATH}/aa_6f_"*
     rm -f "${TMP_PATH}/nucl_6f_"*
     rm -f "${TMP_PATH}/pref_"*
+    rm -f "${TMP_PATH}/kmer_ends_"*
     rm -f "${TMP_PATH}/aln_"*
     rm -f "${TMP_PATH}/assembly_"*
     rm -f "${TMP_PATH}/assembledb.sh"
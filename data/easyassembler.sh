@@ -17,20 +17,30 @@ notExists() {
 [   -f "${OUT_FILE}" ] &&  echo "${OUT_FILE} exists already!" && exit 1
 [ ! -d "${TMP_PATH}" ] &&  echo "tmp directory ${TMP_PATH} not found!" && mkdir -p "${TMP_PATH}"
 
-if notExists "${TMP_PATH}/nucl_reads"; then
-    if [ -n "${PAIRED_END}" ]; then
-        echo "PAIRED END MODE"
+if [ -n "${STREAM_ORFS}" ]; then
+    # merge, extract and translate in one pass, assembledb starts from the ORFs
+    if notExists "${TMP_PATH}/read_orfs.dbtype"; then
         # shellcheck disable=SC2086
-        "$MMSEQS" mergereads "$@" "${TMP_PATH}/nucl_reads" ${VERBOSITY_PAR} \
-            || fail "mergereads failed"
-    else
-        # shellcheck disable=SC2086
-        "$MMSEQS" createdb "$@" "${TMP_PATH}/nucl_reads" ${CREATEDB_PAR} \
-            || fail "createdb failed"
+        "$MMSEQS" readorfs "$@" "${TMP_PATH}/read_orfs" ${READORFS_PAR} \
+            || fail "readorfs failed"
+    fi
+    INPUT="${TMP_PATH}/read_orfs"
+else
+    if notExists "${TMP_PATH}/nucl_reads"; then
+        if [ -n "${PAIRED_END}" ]; then
+            echo "PAIRED END MODE"
+            # shellcheck disable=SC2086
+            "$MMSEQS" mergereads "$@" "${TMP_PATH}/nucl_reads" ${VERBOSITY_PAR} \
+                || fail "mergereads failed"
+        else
+            # shellcheck disable=SC2086
+            "$MMSEQS" createdb "$@" "${TMP_PATH}/nucl_reads" ${CREATEDB_PAR} \
+                || fail "createdb failed"
+        fi
     fi
+    INPUT="${TMP_PATH}/nucl_reads"
 fi
 
-INPUT="${TMP_PATH}/nucl_reads"
 if notExists "${TMP_PATH}/assembly.dbtype"; then
     # shellcheck disable=SC2086
     "$MMSEQS" "${ASSEMBLY_MODULE}" "${INPUT}" "${TMP_PATH}/assembly" "${TMP_PATH}/assembly_tmp" ${ASSEMBLY_PAR} \
@@ -62,8 +72,13 @@ if [ -n "${REMOVE_TMP}" ]; then
     echo "Removing temporary files"
     "$MMSEQS" rmdb "${TMP_PATH}/assembly"
     "$MMSEQS" rmdb "${TMP_PATH}/assembly_h"
-    "$MMSEQS" rmdb "${TMP_PATH}/nucl_reads"
-    "$MMSEQS" rmdb "${TMP_PATH}/nucl_reads_h"
+    if [ -n "${STREAM_ORFS}" ]; then
+        "$MMSEQS" rmdb "${TMP_PATH}/read_orfs"
+        "$MMSEQS" rmdb "${TMP_PATH}/read_orfs_h"
+    else
+        "$MMSEQS" rmdb "${TMP_PATH}/nucl_reads"
+        "$MMSEQS" rmdb "${TMP_PATH}/nucl_reads_h"
+    fi
     rm -rf "${TMP_PATH}/assembly_tmp"
     rm -f "${TMP_PATH}/easyassembler.sh"
 fi
\ No newline at end of file
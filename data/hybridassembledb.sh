@@ -6,8 +6,22 @@ fail() {
     exit 1
 }
 
+# concurrent steps still running on exit, e.g. after a sibling step failed, are stopped so that
+# they do not keep writing into TMP_PATH or the step cache. Their partial outputs have no .dbtype
+# file and are computed again by the next run.
+BG_PIDS=""
+stopBackground() {
+    for PID in $BG_PIDS; do
+        kill "$PID" 2>/dev/null || true
+        wait "$PID" 2>/dev/null || true
+    done
+    unlockSteps
+}
+trap stopBackground EXIT
+
+# outputs in the step cache are kept for later runs
 deleteIncremental() {
-    if [ -n "$REMOVE_INCREMENTAL_TMP" ] &&  [ -n "$1" ]; then
+    if [ -n "$REMOVE_INCREMENTAL_TMP" ] && [ -z "$CACHE_PATH" ] && [ -n "$1" ]; then
          "$MMSEQS" rmdb "$1"
     fi
 }
@@ -16,6 +30,50 @@ notExists() {
 	[ ! -f "$1" ]
 }
 
+# extractorfs writes the ORFs $1 and their headers, the .dbtype files mark both as complete
+orfsNotExist() {
+    notExists "$1.dbtype" || notExists "$1_h.dbtype"
+}
+
+# locks the step directory $1 until this run exits, runs that share a step key wait for each other
+# and then reuse the finished outputs. The lock of a run that no longer exists is taken over.
+lockStep() {
+    while ! mkdir "$1.lock" 2>/dev/null; do
+        LOCK_PID="$(cat "$1.lock/pid" 2>/dev/null || true)"
+        if [ "$LOCK_PID" = "$$" ]; then
+            return
+        fi
+        if [ -n "$LOCK_PID" ] && ! kill -0 "$LOCK_PID" 2>/dev/null; then
+            rm -rf "$1.lock"
+        else
+            sleep 1
+        fi
+    done
+    echo "$$" > "$1.lock/pid"
+}
+
+unlockSteps() {
+    if [ -n "$CACHE_PATH" ]; then
+        for LOCK in "${CACHE_PATH}"/*.lock; do
+            if [ "$(cat "$LOCK/pid" 2>/dev/null || true)" = "$$" ]; then
+                rm -rf "$LOCK"
+            fi
+        done
+    fi
+}
+
+# directory of the step whose key is in the variable $1, steps without step cache write to TMP_PATH
+stepPath() {
+    if [ -n "$CACHE_PATH" ]; then
+        eval STEP_KEY="\$$1"
+        mkdir -p "${CACHE_PATH}/${STEP_KEY}"
+        lockStep "${CACHE_PATH}/${STEP_KEY}"
+        echo "${CACHE_PATH}/${STEP_KEY}"
+    else
+        echo "${TMP_PATH}"
+    fi
+}
+
 # check input variables
 [ -z "${OUT_FILE}" ] && echo "Please provide OUT_FILE" && exit 1
 [ -z "${TMP_PATH}" ] && echo "Please provide TMP_PATH" && exit 1
@@ -27,36 +85,61 @@ notExists() {
 
 
 INPUT="$1"
-if notExists "${TMP_PATH}/nucl_6f_start"; then
+ORF_PATH="$(stepPath ORFS_KEY)"
+# the start and long ORF extractions are independent and run concurrently,
+# each with half of the threads if both have to be computed
+START_PAR="${EXTRACTORFS_START_PAR}"
+LONG_PAR="${EXTRACTORFS_LONG_PAR}"
+if orfsNotExist "${ORF_PATH}/nucl_6f_start" && orfsNotExist "${ORF_PATH}/nucl_6f_long"; then
+    START_PAR="${EXTRACTORFS_START_HALF_PAR}"
+    LONG_PAR="${EXTRACTORFS_LONG_HALF_PAR}"
+fi
+START_PID=""
+if orfsNotExist "${ORF_PATH}/nucl_6f_start"; then
     # shellcheck disable=SC2086
-    "$MMSEQS" extractorfs "${INPUT}" "${TMP_PATH}/nucl_6f_start" ${EXTRACTORFS_START_PAR} \
-        || fail "extractorfs start step died"
+    "$MMSEQS" extractorfs "${INPUT}" "${ORF_PATH}/nucl_6f_start" ${START_PAR} &
+    START_PID=$!
+    BG_PIDS="$BG_PIDS $START_PID"
 fi
 
-if notExists "${TMP_PATH}/nucl_6f_long"; then
+if orfsNotExist "${ORF_PATH}/nucl_6f_long"; then
     # shellcheck disable=SC2086
-    "$MMSEQS" extractorfs "${INPUT}" "${TMP_PATH}/nucl_6f_long" ${EXTRACTORFS_LONG_PAR} \
+    "$MMSEQS" extractorfs "${INPUT}" "${ORF_PATH}/nucl_6f_long" ${LONG_PAR} \
         || fail "extractorfs longest step died"
 fi
 
-if notExists "${TMP_PATH}/nucl_6f_start_long"; then
-    "$MMSEQS" concatdbs "${TMP_PATH}/nucl_6f_long" "${TMP_PATH}/nucl_6f_start" "${TMP_PATH}/nucl_6f_start_long" \
-        || fail "concatdbs start long step died"
+if [ -n "$START_PID" ]; then
+    wait "$START_PID" || fail "extractorfs start step died"
 fi
+BG_PIDS=""
 
-if notExists "${TMP_PATH}/nucl_6f_start_long_h"; then
+# link instead of copying the ORFs, nucl_6f_long and nucl_6f_start have to be kept until the end
+HEADER_PID=""
+if notExists "${ORF_PATH}/nucl_6f_start_long_h.dbtype"; then
     # shellcheck disable=SC2086
-    "$MMSEQS" concatdbs "${TMP_PATH}/nucl_6f_long_h" "${TMP_PATH}/nucl_6f_start_h" "${TMP_PATH}/nucl_6f_start_long_h" ${VERBOSITY_PAR} \
+    "$MMSEQS" virtualconcatdbs "${ORF_PATH}/nucl_6f_long_h" "${ORF_PATH}/nucl_6f_start_h" "${ORF_PATH}/nucl_6f_start_long_h" ${VERBOSITY_PAR} &
+    HEADER_PID=$!
+    BG_PIDS="$BG_PIDS $HEADER_PID"
+fi
+
+if notExists "${ORF_PATH}/nucl_6f_start_long.dbtype"; then
+    # shellcheck disable=SC2086
+    "$MMSEQS" virtualconcatdbs "${ORF_PATH}/nucl_6f_long" "${ORF_PATH}/nucl_6f_start" "${ORF_PATH}/nucl_6f_start_long" ${VERBOSITY_PAR} \
         || fail "concatdbs start long step died"
 fi
 
-if notExists "${TMP_PATH}/aa_6f_start_long"; then
-    "$MMSEQS" translatenucs "${TMP_PATH}/nucl_6f_start_long" "${TMP_PATH}/aa_6f_start_long" --add-orf-stop \
+if notExists "${ORF_PATH}/aa_6f_start_long.dbtype"; then
+    "$MMSEQS" translatenucs "${ORF_PATH}/nucl_6f_start_long" "${ORF_PATH}/aa_6f_start_long" --add-orf-stop \
         || fail "translatenucs step died"
 fi
 
-INPUT_AA="${TMP_PATH}/aa_6f_start_long"
-INPUT_NUCL="${TMP_PATH}/nucl_6f_start_long"
+if [ -n "$HEADER_PID" ]; then
+    wait "$HEADER_PID" || fail "concatdbs start long header step died"
+fi
+BG_PIDS=""
+
+INPUT_AA="${ORF_PATH}/aa_6f_start_long"
+INPUT_NUCL="${ORF_PATH}/nucl_6f_start_long"
 STEP=0
 if [ -z "$NUM_IT" ]; then
     NUM_IT=1
@@ -64,93 +147,113 @@ fi
 
 while [ $STEP -lt $NUM_IT ]; do
     echo "STEP: $STEP"
+    PREF_PATH="$(stepPath "PREF${STEP}_KEY")"
+    ALN_PATH="$(stepPath "ALN${STEP}_KEY")"
+    ALN_NUCL_PATH="$(stepPath "ALN_NUCL${STEP}_KEY")"
+    ASSEMBLY_PATH="$(stepPath "ASSEMBLY${STEP}_KEY")"
 
     # 1. Finding exact $k$-mer matches.
-    if notExists "${TMP_PATH}/pref_$STEP.done"; then
+    if notExists "${PREF_PATH}/pref_$STEP.done"; then
         # shellcheck disable=SC2086
-        "$MMSEQS" kmermatcher "$INPUT_AA" "${TMP_PATH}/pref_$STEP" ${KMERMATCHER_PAR}   \
+        "$MMSEQS" kmermatcher "$INPUT_AA" "${PREF_PATH}/pref_$STEP" ${KMERMATCHER_PAR}   \
             || fail "Kmer matching step died"
         deleteIncremental "$PREV_KMER_PREF"
-        touch "${TMP_PATH}/pref_${STEP}.done"
-        PREV_KMER_PREF="${TMP_PATH}/pref_${STEP}"
+        touch "${PREF_PATH}/pref_${STEP}.done"
+        PREV_KMER_PREF="${PREF_PATH}/pref_${STEP}"
     fi
 
     # 2. Ungapped alignment
-    if notExists "${TMP_PATH}/aln_$STEP.done"; then
+    if notExists "${ALN_PATH}/aln_$STEP.done"; then
         # shellcheck disable=SC2086
-        "$MMSEQS" rescorediagonal "$INPUT_AA" "$INPUT_AA" "${TMP_PATH}/pref_$STEP" "${TMP_PATH}/aln_$STEP" ${UNGAPPED_ALN_PAR} \
+        "$MMSEQS" rescorediagonal "$INPUT_AA" "$INPUT_AA" "${PREF_PATH}/pref_$STEP" "${ALN_PATH}/aln_$STEP" ${UNGAPPED_ALN_PAR} \
             || fail "Ungapped alignment step died"
-        touch "${TMP_PATH}/aln_$STEP.done"
+        touch "${ALN_PATH}/aln_$STEP.done"
         deleteIncremental "$PREV_ALN"
-        PREV_ALN="${TMP_PATH}/aln_$STEP"
+        PREV_ALN="${ALN_PATH}/aln_$STEP"
     fi
 
     # 3. Ungapped alignment protein 2 nucl
-    if notExists "${TMP_PATH}/aln_nucl_$STEP.done"; then
-        "$MMSEQS" proteinaln2nucl "$INPUT_NUCL" "$INPUT_NUCL" "$INPUT_AA"  "$INPUT_AA"  "${TMP_PATH}/aln_$STEP" "${TMP_PATH}/aln_nucl_$STEP"  \
+    if notExists "${ALN_NUCL_PATH}/aln_nucl_$STEP.done"; then
+        "$MMSEQS" proteinaln2nucl "$INPUT_NUCL" "$INPUT_NUCL" "$INPUT_AA"  "$INPUT_AA"  "${ALN_PATH}/aln_$STEP" "${ALN_NUCL_PATH}/aln_nucl_$STEP"  \
             || fail "Ungapped alignment 2 nucl step died"
         deleteIncremental "$PREV_ALN_NUCL"
-        touch "${TMP_PATH}/aln_nucl_${STEP}.done"
-        PREV_ALN_NUCL="${TMP_PATH}/aln_nucl_$STEP"
+        touch "${ALN_NUCL_PATH}/aln_nucl_${STEP}.done"
+        PREV_ALN_NUCL="${ALN_NUCL_PATH}/aln_nucl_$STEP"
     fi
 
     # 4. Assemble
-    if notExists "${TMP_PATH}/assembly_aa_nucl_$STEP.done"; then
+    if notExists "${ASSEMBLY_PATH}/assembly_aa_nucl_$STEP.done"; then
         # shellcheck disable=SC2086
-        "$MMSEQS" hybridassembleresults "$INPUT_NUCL" "$INPUT_AA" "${TMP_PATH}/aln_nucl_$STEP" "${TMP_PATH}/assembly_nucl_$STEP" "${TMP_PATH}/assembly_aa_$STEP" ${ASSEMBLE_RESULT_PAR} \
+        "$MMSEQS" hybridassembleresults "$INPUT_NUCL" "$INPUT_AA" "${ALN_NUCL_PATH}/aln_nucl_$STEP" "${ASSEMBLY_PATH}/assembly_nucl_$STEP" "${ASSEMBLY_PATH}/assembly_aa_$STEP" ${ASSEMBLE_RESULT_PAR} \
             || fail "Assembly step died"
-        touch "${TMP_PATH}/assembly_aa_nucl_$STEP.done"
+        touch "${ASSEMBLY_PATH}/assembly_aa_nucl_$STEP.done"
         deleteIncremental "$PREV_ASSEMBLY_AA"
         deleteIncremental "$PREV_ASSEMBLY_NUCL"
-        PREV_ASSEMBLY_AA="${TMP_PATH}/assembly_aa_$STEP"
-        PREV_ASSEMBLY_NUCL="${TMP_PATH}/assembly_nucl_$STEP"
+        PREV_ASSEMBLY_AA="${ASSEMBLY_PATH}/assembly_aa_$STEP"
+        PREV_ASSEMBLY_NUCL="${ASSEMBLY_PATH}/assembly_nucl_$STEP"
     fi
 
-    INPUT_AA="${TMP_PATH}/assembly_aa_$STEP"
-    INPUT_NUCL="${TMP_PATH}/assembly_nucl_$STEP"
+    INPUT_AA="${ASSEMBLY_PATH}/assembly_aa_$STEP"
+    INPUT_NUCL="${ASSEMBLY_PATH}/assembly_nucl_$STEP"
+    ABSORBED="${ABSORBED} ${ASSEMBLY_PATH}/assembly_nucl_${STEP}_absorbed"
     STEP="$((STEP+1))"
+    # stop once an iteration barely grows the contigs
+    if [ -f "${INPUT_NUCL}.converged" ]; then
+        echo "Converged after step $((STEP-1))"
+        break
+    fi
 done
 STEP="$((STEP-1))"
 
-RESULT_NUCL="${TMP_PATH}/assembly_nucl_$STEP"
+RESULT_NUCL="${ASSEMBLY_PATH}/assembly_nucl_$STEP"
+# selections depend on all parameters, they are never written to the step cache
+ONLY_ASSEMBLED="${TMP_PATH}/assembly_nucl_${STEP}_only_assembled"
+MERGED="${TMP_PATH}/assembly_nucl_${STEP}.merged"
 #RESULT_AA="${TMP_PATH}/assembly_aa_$STEP"
 
 # select only assembled orfs
-if notExists "${RESULT_NUCL}_only_assembled.index"; then
-    awk 'NR == FNR { f[$1] = $0; next } $1 in f { print f[$1], $0 }' "${RESULT_NUCL}.index" "${TMP_PATH}/nucl_6f_start_long.index" > "${RESULT_NUCL}_tmp.index"
-    awk '$3 > $6 { print }' "${RESULT_NUCL}_tmp.index" > "${RESULT_NUCL}_only_assembled.index"
+if notExists "${ONLY_ASSEMBLED}.index"; then
+    # shellcheck disable=SC2086
+    "$MMSEQS" selectentries "${RESULT_NUCL}" "${ONLY_ASSEMBLED}.index" --grown-from "${ORF_PATH}/nucl_6f_start_long" ${THREADS_PAR} \
+        || fail "Select assembled ORFs died"
 fi
 
-if notExists "${RESULT_NUCL}_only_assembled"; then
-    ln -s "${RESULT_NUCL}" "${RESULT_NUCL}_only_assembled"
+if notExists "${ONLY_ASSEMBLED}"; then
+    ln -s "${RESULT_NUCL}" "${ONLY_ASSEMBLED}"
 fi
 
-if notExists "${RESULT_NUCL}_only_assembled.dbtype"; then
-    ln -s "${RESULT_NUCL}.dbtype" "${RESULT_NUCL}_only_assembled.dbtype"
+if notExists "${ONLY_ASSEMBLED}.dbtype"; then
+    ln -s "${RESULT_NUCL}.dbtype" "${ONLY_ASSEMBLED}.dbtype"
 fi
 
-if notExists "${RESULT_NUCL}_only_assembled_h"; then
-    ln -s "${TMP_PATH}/nucl_6f_start_long_h" "${RESULT_NUCL}_only_assembled_h"
+# nucl_6f_start_long_h consists of linked data files, so it is linked through its index
+if notExists "${ONLY_ASSEMBLED}_h.dbtype"; then
+    # shellcheck disable=SC2086
+    "$MMSEQS" virtualconcatdbs "${ORF_PATH}/nucl_6f_start_long_h" "${ONLY_ASSEMBLED}_h" --preserve-keys ${VERBOSITY_PAR} \
+        || fail "Linking assembled ORF headers died"
 fi
 
-if notExists "${RESULT_NUCL}_only_assembled_h.index"; then
-    ln -s "${TMP_PATH}/nucl_6f_start_long_h.index" "${RESULT_NUCL}_only_assembled_h.index"
-fi
 
-if notExists "${RESULT_NUCL}_only_assembled_h.dbtype"; then
-    ln -s "${TMP_PATH}/nucl_6f_start_long_h.dbtype" "${RESULT_NUCL}_only_assembled_h.dbtype"
+# drop reads whose ORFs were already absorbed into a contig
+READS="${INPUT}"
+if [ -n "${SKIP_ABSORBED_READS}" ]; then
+    if notExists "${TMP_PATH}/reads_unabsorbed.dbtype"; then
+        # shellcheck disable=SC2086
+        "$MMSEQS" filterabsorbed "${INPUT}" "${ORF_PATH}/nucl_6f_start_long_h" ${ABSORBED} "${TMP_PATH}/reads_unabsorbed" ${THREADS_PAR} \
+            || fail "Filter absorbed reads died"
+    fi
+    READS="${TMP_PATH}/reads_unabsorbed"
 fi
 
-
-if notExists "${RESULT_NUCL}.merged.dbtype"; then
+if notExists "${MERGED}.dbtype"; then
     # shellcheck disable=SC2086
-    "$MMSEQS" concatdbs "${INPUT}" "${RESULT_NUCL}_only_assembled" "${RESULT_NUCL}.merged" \
+    "$MMSEQS" virtualconcatdbs "${READS}" "${ONLY_ASSEMBLED}" "${MERGED}" ${VERBOSITY_PAR} \
     || fail "Concat hybridassemblies and reads died"
 fi
 
 if notExists "${TMP_PATH}/nuclassembly.dbtype"; then
     # shellcheck disable=SC2086
-    "$MMSEQS" nuclassembledb "${RESULT_NUCL}.merged" "${TMP_PATH}/nuclassembly" "${TMP_PATH}/nuclassembly_tmp" ${NUCL_ASM_PAR}
+    "$MMSEQS" nuclassembledb "${MERGED}" "${TMP_PATH}/nuclassembly" "${TMP_PATH}/nuclassembly_tmp" ${NUCL_ASM_PAR}
 fi
 
 # redundancy reduction by using linclust
@@ -171,7 +274,9 @@ if notExists "${TMP_PATH}/nuclassembly_rep.dbtype"; then
 fi
 
 if notExists "${CLUST_INPUT}_rep_cycle.index" && [ -f "${TMP_PATH}/nuclassembly_cycle.index" ]; then
-    awk 'NR == FNR { f[$1] = $0; next } $1 in f { print $0 }' "${TMP_PATH}/nuclassembly_cycle.index" "${CLUST_INPUT}_rep.index" > "${CLUST_INPUT}_rep_cycle.index"
+    # shellcheck disable=SC2086
+    "$MMSEQS" selectentries "${CLUST_INPUT}_rep" "${CLUST_INPUT}_rep_cycle.index" --member-of "${TMP_PATH}/nuclassembly_cycle" ${THREADS_PAR} \
+        || fail "Select cyclic representatives died"
     cp "${CLUST_INPUT}_rep_cycle.index" "${OUT_FILE}_cycle.index"
 fi
 
@@ -188,5 +293,6 @@ if [ -n "$REMOVE_TMP" ]; then
     rm -f "${TMP_PATH}/pref_"*
     rm -f "${TMP_PATH}/aln_"*
     rm -f "${TMP_PATH}/assembly_"*
+    rm -f "${TMP_PATH}/reads_unabsorbed"*
     rm -f "${TMP_PATH}/nuclassembly_2/latest/"*
 fi
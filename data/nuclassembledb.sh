@@ -6,8 +6,9 @@ fail() {
     exit 1
 }
 
+# outputs in the step cache are kept for later runs
 deleteIncremental() {
-    if [ -n "$REMOVE_INCREMENTAL_TMP" ] &&  [ -n "$1" ]; then
+    if [ -n "$REMOVE_INCREMENTAL_TMP" ] && [ -z "$CACHE_PATH" ] && [ -n "$1" ]; then
          "$MMSEQS" rmdb "$1"
     fi
 }
@@ -16,6 +17,47 @@ notExists() {
 	[ ! -f "$1" ]
 }
 
+# locks the step directory $1 until this run exits, runs that share a step key wait for each other
+# and then reuse the finished outputs. The lock of a run that no longer exists is taken over.
+lockStep() {
+    while ! mkdir "$1.lock" 2>/dev/null; do
+        LOCK_PID="$(cat "$1.lock/pid" 2>/dev/null || true)"
+        if [ "$LOCK_PID" = "$$" ]; then
+            return
+        fi
+        if [ -n "$LOCK_PID" ] && ! kill -0 "$LOCK_PID" 2>/dev/null; then
+            rm -rf "$1.lock"
+        else
+            sleep 1
+        fi
+    done
+    echo "$$" > "$1.lock/pid"
+}
+
+unlockSteps() {
+    if [ -n "$CACHE_PATH" ]; then
+        for LOCK in "${CACHE_PATH}"/*.lock; do
+            if [ "$(cat "$LOCK/pid" 2>/dev/null || true)" = "$$" ]; then
+                rm -rf "$LOCK"
+            fi
+        done
+    fi
+}
+
+# directory of the step whose key is in the variable $1, steps without step cache write to TMP_PATH
+stepPath() {
+    if [ -n "$CACHE_PATH" ]; then
+        eval STEP_KEY="\$$1"
+        mkdir -p "${CACHE_PATH}/${STEP_KEY}"
+        lockStep "${CACHE_PATH}/${STEP_KEY}"
+        echo "${CACHE_PATH}/${STEP_KEY}"
+    else
+        echo "${TMP_PATH}"
+    fi
+}
+
+trap unlockSteps EXIT
+
 cyclecheck() {
 	if [ -n "$CALL_CYCLE_CHECK" ]; then
         if notExists "${1}_cycle.done"; then
@@ -27,19 +69,17 @@ cyclecheck() {
             if [ -s "${1}_cycle" ]; then
 
                 if notExists "${1}_noneCycle"; then
-                    awk 'NR==FNR { a[$1]=$0; next } !($1 in a) {print $0}' "${1}_cycle.index" \
-                    "${1}.index" > "${1}_noneCycle.index"
+                    # shellcheck disable=SC2086
+                    "$MMSEQS" selectentries "$1" "${1}_noneCycle.index" --not-member-of "${1}_cycle" ${THREADS_PAR} \
+                        || fail "Select non cyclic contigs died"
                     ln -s "$1" "${1}_noneCycle"
                     ln -s "${1}.dbtype" "${1}_noneCycle.dbtype"
                 fi
 
-                if [ -z "$PREV_CYCLE_ALL" ]; then
-                    # shellcheck disable=SC2086
-                    "$MMSEQS" mvdb "${1}_cycle" "${1}_cycle_all"
-                else
-                    # shellcheck disable=SC2086
-                    "$MMSEQS" concatdbs "${PREV_CYCLE_ALL}" "${1}_cycle" "${1}_cycle_all" --preserve-keys
-                fi
+                # _cycle_all only links the data of all _cycle DBs, which are kept until the end
+                # shellcheck disable=SC2086
+                "$MMSEQS" virtualconcatdbs ${PREV_CYCLE_ALL} "${1}_cycle" "${1}_cycle_all" --preserve-keys ${VERBOSITY_PAR} \
+                    || fail "Linking cycle contigs died"
 
             else
                 ln -s "$1" "${1}_noneCycle"
@@ -47,11 +87,9 @@ cyclecheck() {
                 ln -s "${1}.dbtype" "${1}_noneCycle.dbtype"
             fi
             touch "${1}_cycle.done"
-            deleteIncremental "$PREV_CYCLE"
-            PREV_CYCLE="${1}_cycle"
         fi
 
-        if [ -s "${1}_cycle_all" ]; then
+        if [ -s "${1}_cycle_all.index" ]; then
             deleteIncremental "${PREV_CYCLE_ALL}"
             PREV_CYCLE_ALL="${1}_cycle_all"
         fi
@@ -80,75 +118,83 @@ fi
 
 while [ $STEP -lt $NUM_IT ]; do
     echo "STEP: $STEP"
+    PREF_PATH="$(stepPath "PREF${STEP}_KEY")"
+    ALN_PATH="$(stepPath "ALN${STEP}_KEY")"
+    ASSEMBLY_PATH="$(stepPath "ASSEMBLY${STEP}_KEY")"
 
     # 1. Finding exact $k$-mer matches.
-    if notExists "${TMP_PATH}/pref_${STEP}.done"; then
+    if notExists "${PREF_PATH}/pref_${STEP}.done"; then
         # shellcheck disable=SC2086
-        "$MMSEQS" kmermatcher "$INPUT" "${TMP_PATH}/pref_${STEP}" ${KMERMATCHER_PAR} \
+        "$MMSEQS" kmermatcher "$INPUT" "${PREF_PATH}/pref_${STEP}" ${KMERMATCHER_PAR} \
             || fail "Kmer matching step died"
         deleteIncremental "$PREV_KMER_PREF"
-        touch "${TMP_PATH}/pref_${STEP}.done"
-        PREV_KMER_PREF="${TMP_PATH}/pref_${STEP}"
+        touch "${PREF_PATH}/pref_${STEP}.done"
+        PREV_KMER_PREF="${PREF_PATH}/pref_${STEP}"
     fi
 
     # 2. Ungapped alignment
-    if notExists "${TMP_PATH}/aln_${STEP}.done"; then
+    if notExists "${ALN_PATH}/aln_${STEP}.done"; then
         # shellcheck disable=SC2086
-        "$MMSEQS" rescorediagonal "$INPUT" "$INPUT" "${TMP_PATH}/pref_${STEP}" "${TMP_PATH}/aln_${STEP}" ${UNGAPPED_ALN_PAR} \
+        "$MMSEQS" rescorediagonal "$INPUT" "$INPUT" "${PREF_PATH}/pref_${STEP}" "${ALN_PATH}/aln_${STEP}" ${UNGAPPED_ALN_PAR} \
             || fail "Ungapped alignment step died"
-        touch "${TMP_PATH}/aln_${STEP}.done"
+        touch "${ALN_PATH}/aln_${STEP}.done"
         deleteIncremental "$PREV_ALN"
-        PREV_ALN="${TMP_PATH}/aln_${STEP}"
+        PREV_ALN="${ALN_PATH}/aln_${STEP}"
     fi
 
     # 3. Assemble
-    if notExists "${TMP_PATH}/assembly_${STEP}.done"; then
+    if notExists "${ASSEMBLY_PATH}/assembly_${STEP}.done"; then
         # shellcheck disable=SC2086
-        "$MMSEQS" assembleresults "$INPUT" "${TMP_PATH}/aln_${STEP}" "${TMP_PATH}/assembly_${STEP}" ${ASSEMBLE_RESULT_PAR} \
+        "$MMSEQS" assembleresults "$INPUT" "${ALN_PATH}/aln_${STEP}" "${ASSEMBLY_PATH}/assembly_${STEP}" ${ASSEMBLE_RESULT_PAR} \
             || fail "Assembly step died"
-        touch "${TMP_PATH}/assembly_${STEP}.done"
+        touch "${ASSEMBLY_PATH}/assembly_${STEP}.done"
         deleteIncremental "$PREV_ASSEMBLY"
         deleteIncremental "$PREV_ASSEMBLY_STEP"
     fi
 
-    PREV_ASSEMBLY="${TMP_PATH}/assembly_${STEP}"
-    PREV_ASSEMBLY_STEP="${TMP_PATH}/assembly_${STEP}"
+    PREV_ASSEMBLY="${ASSEMBLY_PATH}/assembly_${STEP}"
+    PREV_ASSEMBLY_STEP="${ASSEMBLY_PATH}/assembly_${STEP}"
     cyclecheck "${PREV_ASSEMBLY}"
 
     INPUT="${PREV_ASSEMBLY}"
     STEP="$((STEP+1))"
+    # stop once an iteration barely grows the contigs
+    if [ -f "${PREV_ASSEMBLY_STEP}.converged" ]; then
+        echo "Converged after step $((STEP-1))"
+        break
+    fi
 done
 STEP="$((STEP-1))"
-RESULT="${TMP_PATH}/assembly_${STEP}"
+RESULT="${ASSEMBLY_PATH}/assembly_${STEP}"
 
 if [ -n "$PREV_CYCLE_ALL" ]; then
 
     RESULT="${TMP_PATH}/assembly_merged"
-    if notExists "${TMP_PATH}/assembly_merged"; then
+    if notExists "${TMP_PATH}/assembly_merged.dbtype"; then
         # shellcheck disable=SC2086
-        "$MMSEQS" concatdbs "${PREV_ASSEMBLY}" "${PREV_CYCLE_ALL}" "${TMP_PATH}/assembly_merged" --preserve-keys \
+        "$MMSEQS" virtualconcatdbs "${PREV_ASSEMBLY}" "${PREV_CYCLE_ALL}" "${TMP_PATH}/assembly_merged" --preserve-keys ${VERBOSITY_PAR} \
              || fail "Concatenation of non cyclic and cyclic contigs died"
     fi
 fi
 
-# select only assembled sequences
-if notExists "${RESULT}_only_assembled.index"; then
-    awk 'NR == FNR { f[$1] = $0; next } $1 in f { print f[$1], $0 }' "${RESULT}.index" "${SOURCE}.index" > "${RESULT}_tmp.index"
-    awk '$3 > $6 { print }' "${RESULT}_tmp.index" > "${RESULT}_only_assembled.index"
-fi
+# selections depend on all parameters, they are never written to the step cache
+SELECTED="${TMP_PATH}/assembly_only_assembled_filtered.index"
 
-# select only sequences fullfilling a minimum length threshold
-if notExists "${RESULT}_only_assembled_filtered.index"; then
-    # shellcheck disable=SC208
-    awk -v thr="${MIN_CONTIG_LEN}" '$3 > (thr+1) { print }' "${RESULT}_only_assembled.index" > "${RESULT}_only_assembled_filtered.index"
+# select only assembled sequences fullfilling a minimum length threshold
+if notExists "${SELECTED}"; then
+    # shellcheck disable=SC2086
+    "$MMSEQS" selectentries "${RESULT}" "${SELECTED}" --grown-from "${SOURCE}" --min-entry-len "${MIN_CONTIG_LEN}" ${THREADS_PAR} \
+        || fail "Select assembled contigs died"
 fi
 
 # create db outfile
 if notExists "${OUT_FILE}.dbtype"; then
-    "$MMSEQS" createsubdb "${RESULT}_only_assembled_filtered.index" "${RESULT}" "${OUT_FILE}" --subdb-mode 0 \
+    "$MMSEQS" createsubdb "${SELECTED}" "${RESULT}" "${OUT_FILE}" --subdb-mode 0 \
         || fail "Create filtered contig db died"
     if [ -n "$PREV_CYCLE_ALL" ]; then
-        awk 'NR == FNR { f[$1] = $0; next } $1 in f { print $0 }' "${PREV_CYCLE_ALL}.index" "${OUT_FILE}.index" > "${OUT_FILE}_cycle.index"
+        # shellcheck disable=SC2086
+        "$MMSEQS" selectentries "${OUT_FILE}" "${OUT_FILE}_cycle.index" --member-of "${PREV_CYCLE_ALL}" ${THREADS_PAR} \
+            || fail "Select cyclic contigs died"
     fi
 fi
 
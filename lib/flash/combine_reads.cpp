@@ -36,11 +36,23 @@
 #  define WITH_SSE2
 #endif
 
+#if defined(__GNUC__) && defined(__AVX2__)
+#  define WITH_AVX2
+#endif
+
+#if defined(__GNUC__) && defined(__AVX512BW__)
+#  define WITH_AVX512BW
+#endif
+
 #ifdef WITH_SSE2
 #  include <xmmintrin.h>
 #  include <emmintrin.h>
 #endif
 
+#if defined(WITH_AVX2) || defined(WITH_AVX512BW)
+#  include <immintrin.h>
+#endif
+
 #ifdef WITH_SSE2
 
 
@@ -64,26 +76,6 @@
 #	define max(a,b) (((a) > (b)) ? (a) : (b))
 #	define min(a,b) (((a) < (b)) ? (a) : (b))
 
-/* Sum the values an 8 x 8 bit vector and return a 32-bit result.  */
-static inline uint32_t
-hsum32_v8(__m128i v)
-{
-    v = _mm_sad_epu8(v, _mm_set1_epi8(0));
-    return (uint32_t)_mm_extract_epi16(v, 0) +
-           (uint32_t)_mm_extract_epi16(v, 4);
-}
-
-/* Sum the values an 8 x 16 bit vector and return a 32-bit result.  */
-static inline uint32_t
-hsum32_v16(__m128i v)
-{
-    __m128i mask = _mm_set1_epi32(0x0000ffff);
-    v = _mm_add_epi32(v & mask, _mm_srli_si128(v, 2) & mask);
-    v = _mm_add_epi32(v, _mm_srli_si128(v, 4));
-    v = _mm_add_epi32(v, _mm_srli_si128(v, 8));
-    return _mm_cvtsi128_si32(v);
-}
-
 #endif /* WITH_SSE2 */
 
 /*
@@ -96,6 +88,9 @@ hsum32_v16(__m128i v)
  * @haveN
  *	As an optimization, this can be set to %false to indicate that neither
  *	sequence contains an uncalled base (represented as an N character).
+ * @max_mismatches
+ *	The comparison is abandoned as soon as more mismatches than this are
+ *	found.
  * @len_p
  *	Pointer to the length of the sequence.  This value will be updated to
  *	subtract the number of positions at which an uncalled base (N) exists in
@@ -106,13 +101,17 @@ hsum32_v16(__m128i v)
  * @mismatch_qual_total_ret
  *	Location into which to return the sum of lesser quality scores at
  *	mismatch sites.
+ *
+ * Returns %false if the comparison was abandoned, the returned statistics are
+ * undefined in that case.
  */
-static inline void
+static inline bool
 compute_mismatch_stats(const char * seq_1,
                        const char * seq_2,
                        const char * qual_1,
                        const char * qual_2,
                        bool haveN,
+                       unsigned max_mismatches,
                        int * len_p,
                        unsigned * num_mismatches_ret,
                        unsigned * mismatch_qual_total_ret)
@@ -129,6 +128,9 @@ compute_mismatch_stats(const char * seq_1,
             } else {
                 if (seq_1[i] != seq_2[i])  {
                     num_mismatches++;
+                    if (num_mismatches > max_mismatches) {
+                        return false;
+                    }
                     mismatch_qual_total += min(qual_1[i], qual_2[i]);
                 }
             }
@@ -140,112 +142,104 @@ compute_mismatch_stats(const char * seq_1,
          * and therefore no further checks for N's are needed.
          *
          * Note: this optimization is only useful if most reads don't
-         * contain N characters.  */
-
-#ifdef WITH_SSE2
-
-        /* Optional vectorized implementation (about twice as fast as
-         * nonvectorized on x86_64).  */
-
-        while (len >= 16) {
+         * contain N characters.
+         *
+         * The vectorized implementations count mismatches exactly after
+         * every block from the comparison bit mask, so the comparison can
+         * be abandoned early.  Quality scores at mismatch sites are summed
+         * with psadbw into 64 bit counters, which can not overflow.  */
+
+#ifdef WITH_AVX512BW
+        if (len >= 64) {
+            __m512i qual_total_v64 = _mm512_setzero_si512();
+            do {
+                __m512i s1_v8 = _mm512_loadu_si512((const void *)seq_1);
+                __m512i s2_v8 = _mm512_loadu_si512((const void *)seq_2);
+                __m512i q1_v8 = _mm512_loadu_si512((const void *)qual_1);
+                __m512i q2_v8 = _mm512_loadu_si512((const void *)qual_2);
+
+                __mmask64 mismatch = _mm512_cmpneq_epi8_mask(s1_v8, s2_v8);
+                num_mismatches += __builtin_popcountll(mismatch);
+                if (num_mismatches > max_mismatches) {
+                    return false;
+                }
 
-            /* 16 x 8 bit counters for number of mismatches  */
-            __m128i num_mismatches_v8 = _mm_set1_epi8(0);
+                /* Minimum quality at mismatch sites, zero elsewhere  */
+                __m512i qadd_v8 = _mm512_maskz_min_epu8(mismatch, q1_v8, q2_v8);
+                qual_total_v64 = _mm512_add_epi64(qual_total_v64,
+                                                  _mm512_sad_epu8(qadd_v8, _mm512_setzero_si512()));
 
-            /* 8 x 16 bit counters for mismatch quality total  */
-            __m128i mismatch_qual_total_v16 = _mm_set1_epi16(0);
+                seq_1 += 64, seq_2 += 64;
+                qual_1 += 64, qual_2 += 64;
+                len -= 64;
+            } while (len >= 64);
+            mismatch_qual_total += (unsigned)_mm512_reduce_add_epi64(qual_total_v64);
+        }
+#endif /* WITH_AVX512BW */
 
-            /* The counters of num_mismatches_v8 will overflow if
-             * 256 mismatches are detected at the same position
-             * modulo 16 bytes.  So, don't process 4096 or more
-             * bytes before reducing the counters.
-             *
-             * mismatch_qual_total_v16 would overflow even faster,
-             * but we use 16-bit counters for it.  */
+#ifdef WITH_AVX2
+        if (len >= 32) {
+            __m256i qual_total_v64 = _mm256_setzero_si256();
+            do {
+                __m256i s1_v8 = _mm256_loadu_si256((const __m256i *)seq_1);
+                __m256i s2_v8 = _mm256_loadu_si256((const __m256i *)seq_2);
+                __m256i q1_v8 = _mm256_loadu_si256((const __m256i *)qual_1);
+                __m256i q2_v8 = _mm256_loadu_si256((const __m256i *)qual_2);
+
+                /* 0xff in bytes where the bases are equal  */
+                __m256i cmpresult = _mm256_cmpeq_epi8(s1_v8, s2_v8);
+                unsigned match = (unsigned)_mm256_movemask_epi8(cmpresult);
+                num_mismatches += 32 - __builtin_popcount(match);
+                if (num_mismatches > max_mismatches) {
+                    return false;
+                }
 
-            int todo = min(len, 255 * 16) & ~0xf;
-            len -= todo;
+                __m256i qmin_v8 = _mm256_min_epu8(q1_v8, q2_v8);
+                __m256i qadd_v8 = _mm256_andnot_si256(cmpresult, qmin_v8);
+                qual_total_v64 = _mm256_add_epi64(qual_total_v64,
+                                                  _mm256_sad_epu8(qadd_v8, _mm256_setzero_si256()));
+
+                seq_1 += 32, seq_2 += 32;
+                qual_1 += 32, qual_2 += 32;
+                len -= 32;
+            } while (len >= 32);
+            __m128i sum_v64 = _mm_add_epi64(_mm256_castsi256_si128(qual_total_v64),
+                                            _mm256_extracti128_si256(qual_total_v64, 1));
+            sum_v64 = _mm_add_epi64(sum_v64, _mm_srli_si128(sum_v64, 8));
+            mismatch_qual_total += (unsigned)_mm_cvtsi128_si32(sum_v64);
+        }
+#endif /* WITH_AVX2 */
 
+#ifdef WITH_SSE2
+        if (len >= 16) {
+            __m128i qual_total_v64 = _mm_setzero_si128();
             do {
-
-                /* Load 16 bases  */
                 __m128i s1_v8 = _mm_loadu_si128((const __m128i *)seq_1);
                 __m128i s2_v8 = _mm_loadu_si128((const __m128i *)seq_2);
-
-                /* Load 16 quality scores  */
                 __m128i q1_v8 = _mm_loadu_si128((const __m128i *)qual_1);
                 __m128i q2_v8 = _mm_loadu_si128((const __m128i *)qual_2);
 
-                /* Compare bases with each other and negate the
-                 * result.  This will produce 0xff in bytes
-                 * where the bases differ and 0x00 in bytes
-                 * where the bases were the same.  */
-                __m128i cmpresult = ~_mm_cmpeq_epi8(s1_v8, s2_v8);
-
-                /* Tally mismatched bases.  Subtracting 0x00 and
-                 * 0xff is equivalent to adding 0 and 1,
-                 * respectively.  */
-                num_mismatches_v8 = _mm_sub_epi8(num_mismatches_v8,
-                                                 cmpresult);
-
-                /* Tally quality scores for mismatched bases.
-                 */
+                __m128i cmpresult = _mm_cmpeq_epi8(s1_v8, s2_v8);
+                unsigned match = (unsigned)_mm_movemask_epi8(cmpresult);
+                num_mismatches += 16 - __builtin_popcount(match);
+                if (num_mismatches > max_mismatches) {
+                    return false;
+                }
 
-                /* Get minimum of each quality score.  */
                 __m128i qmin_v8 = _mm_min_epu8(q1_v8, q2_v8);
+                __m128i qadd_v8 = _mm_andnot_si128(cmpresult, qmin_v8);
+                qual_total_v64 = _mm_add_epi64(qual_total_v64,
+                                               _mm_sad_epu8(qadd_v8, _mm_setzero_si128()));
 
-                /* Select only quality scores at mismatch sites
-                 */
-                __m128i qadd_v8 = qmin_v8 & cmpresult;
-
-                /* Double the precision (8 => 16 bits) and tally  */
-                __m128i qadd_v16_1 = _mm_unpacklo_epi8(qadd_v8,
-                                                       _mm_set1_epi8(0));
-
-                __m128i qadd_v16_2 = _mm_unpackhi_epi8(qadd_v8,
-                                                       _mm_set1_epi8(0));
-
-                mismatch_qual_total_v16 = _mm_add_epi16(mismatch_qual_total_v16,
-                                                        qadd_v16_1);
-
-                mismatch_qual_total_v16 = _mm_add_epi16(mismatch_qual_total_v16,
-                                                        qadd_v16_2);
-
-                /* Advance pointers  */
                 seq_1 += 16, seq_2 += 16;
                 qual_1 += 16, qual_2 += 16;
-                todo -= 16;
-            } while (todo);
-
-            /* Reduce the counters.  */
-            num_mismatches += hsum32_v8(num_mismatches_v8);
-            mismatch_qual_total += hsum32_v16(mismatch_qual_total_v16);
+                len -= 16;
+            } while (len >= 16);
+            qual_total_v64 = _mm_add_epi64(qual_total_v64, _mm_srli_si128(qual_total_v64, 8));
+            mismatch_qual_total += (unsigned)_mm_cvtsi128_si32(qual_total_v64);
         }
-
 #endif /* WITH_SSE2  */
 
-#if 0
-        /* Verify the values computed by the vectorized implementation.
-		 */
-		{
-			int veclen = *len_p & ~0xf;
-			const char *_seq_1 = seq_1 - veclen;
-			const char *_seq_2 = seq_2 - veclen;
-			const char *_qual_1 = qual_1 - veclen;
-			const char *_qual_2 = qual_2 - veclen;
-			unsigned _num_mismatches = 0;
-			unsigned _mismatch_qual_total = 0;
-			for (int i = 0; i < veclen; i++) {
-				if (_seq_1[i] != _seq_2[i])  {
-					_num_mismatches++;
-					_mismatch_qual_total += min(_qual_1[i], _qual_2[i]);
-				}
-			}
-			assert(num_mismatches == _num_mismatches);
-			assert(mismatch_qual_total == _mismatch_qual_total);
-		}
-#endif
-
         /* Process any remainder that wasn't processed by the vectorized
          * implementation.  */
         for (int i = 0; i < len; i++) {
@@ -254,12 +248,35 @@ compute_mismatch_stats(const char * seq_1,
                 mismatch_qual_total += min(qual_1[i], qual_2[i]);
             }
         }
+        if (num_mismatches > max_mismatches) {
+            return false;
+        }
     }
 
     /* Return results in pointer arguments  */
     *num_mismatches_ret = num_mismatches;
     *mismatch_qual_total_ret = mismatch_qual_total;
     *len_p -= num_uncalled;
+    return true;
+}
+
+/*
+ * Largest number of mismatches in an overlap of @score_len scored bases whose
+ * mismatch density (computed as in pair_align()) does not exceed @limit.
+ * Uncalled bases only decrease the scored length, so the bound computed from
+ * the full overlap length is never too strict.
+ */
+static inline unsigned
+max_mismatches_for_density(float limit, int score_len)
+{
+    unsigned n = (unsigned)(limit * score_len);
+    while (n > 0 && n / (float)score_len > limit) {
+        n--;
+    }
+    while ((n + 1) / (float)score_len <= limit) {
+        n++;
+    }
+    return n;
 }
 
 #define NO_ALIGNMENT INT_MIN
@@ -293,14 +310,22 @@ pair_align(const struct read *read_1, const struct read *read_2,
         unsigned mismatch_qual_total;
         int overlap_len = read_1->seq_len - i;
 
-        compute_mismatch_stats(read_1->seq + i,
-                               read_2->seq,
-                               read_1->qual + i,
-                               read_2->qual,
-                               haveN,
-                               &overlap_len,
-                               &num_mismatches,
-                               &mismatch_qual_total);
+        /* An overlap can only be selected if its density is at most the
+         * best one so far.  Densities above max_mismatch_density are never
+         * reported, so they do not have to be tracked either.  */
+        unsigned max_mismatches = max_mismatches_for_density(min(best_mismatch_density, max_mismatch_density),
+                                                             min(overlap_len, max_overlap));
+        if (compute_mismatch_stats(read_1->seq + i,
+                                   read_2->seq,
+                                   read_1->qual + i,
+                                   read_2->qual,
+                                   haveN,
+                                   max_mismatches,
+                                   &overlap_len,
+                                   &num_mismatches,
+                                   &mismatch_qual_total) == false) {
+            continue;
+        }
 
         if (overlap_len >= min_overlap) {
             float score_len = (float)min(overlap_len, max_overlap);
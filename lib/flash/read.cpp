@@ -1,5 +1,7 @@
 #include "read.h"
 
+#include <algorithm>
+
 
 
 //note: N->N, S->S, W->W, U->A, T->A
@@ -9,41 +11,20 @@ static const char* complement_tab =
                 "................................................................"
                 "................................................................";
 
-/* Complements a canonical ASCII base (A, C, G, T, N). */
-static inline char
-complement(char c)
-{
-
-    return complement_tab[(unsigned char)c];
-}
-
-
-static inline char
-identity_mapping(char c)
-{
-    return c;
-}
-
-/* Reverse a sequence of @len chars, applying the mapping function @map_char to
- * each, including the middle char if @len is odd.  */
-static inline void
-reverse_with_mapping(char *p, size_t len, char (*map_char)(char))
+/* Reverse-complement a read in place.  The sequence is complemented by a
+ * direct table lookup while swapping from both ends, the quality scores are
+ * only reversed.  */
+extern void
+reverse_complement(struct read *r)
 {
-    char tmp;
-    char *pp = p + len;
+    char *p = r->seq;
+    char *pp = r->seq + r->seq_len;
     while (pp > p) {
         --pp;
-        tmp = *p;
-        *p = (*map_char)(*pp);
-        *pp = (*map_char)(tmp);
+        char tmp = *p;
+        *p = complement_tab[(unsigned char)*pp];
+        *pp = complement_tab[(unsigned char)tmp];
         ++p;
     }
-}
-
-/* Reverse-complement a read in place.  */
-extern void
-reverse_complement(struct read *r)
-{
-    reverse_with_mapping(r->seq, r->seq_len, complement);
-    reverse_with_mapping(r->qual, r->seq_len, identity_mapping);
+    std::reverse(r->qual, r->qual + r->qual_len);
 }
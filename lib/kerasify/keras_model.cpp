@@ -13,6 +13,12 @@
 #include <utility>
 #include <sstream>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 bool ReadUnsignedInt(std::istream* file, unsigned int* i) {
     KASSERT(file, "Invalid file stream");
     KASSERT(i, "Invalid pointer");
@@ -135,6 +141,78 @@ bool KerasLayerActivation::Apply(Tensor* in, Tensor* out) {
     return true;
 }
 
+bool KerasLayerActivation::BatchShape(int in_size, int* out_size) const {
+    *out_size = in_size;
+    return true;
+}
+
+void KerasLayerActivation::ApplyInPlace(float* data, size_t n) const {
+    switch (activation_type_) {
+    case kLinear:
+        break;
+    case kRelu: {
+        size_t i = 0;
+#if defined(__AVX__)
+        const __m256 zero = _mm256_setzero_ps();
+        for (; i + 8 <= n; i += 8) {
+            _mm256_storeu_ps(data + i,
+                             _mm256_max_ps(_mm256_loadu_ps(data + i), zero));
+        }
+#elif defined(__SSE2__)
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 4 <= n; i += 4) {
+            _mm_storeu_ps(data + i, _mm_max_ps(_mm_loadu_ps(data + i), zero));
+        }
+#endif
+        for (; i < n; i++) {
+            if (data[i] < 0.0) {
+                data[i] = 0.0;
+            }
+        }
+        break;
+    }
+    case kSoftPlus:
+        for (size_t i = 0; i < n; i++) {
+            data[i] = std::log(1.0 + std::exp(data[i]));
+        }
+        break;
+    case kHardSigmoid:
+        for (size_t i = 0; i < n; i++) {
+            float x = (data[i] * 0.2) + 0.5;
+            data[i] = (x <= 0) ? 0.0 : ((x >= 1) ? 1.0 : x);
+        }
+        break;
+    case kSigmoid:
+        for (size_t i = 0; i < n; i++) {
+            float x = data[i];
+            if (x >= 0) {
+                data[i] = 1.0 / (1.0 + std::exp(-x));
+            } else {
+                float z = std::exp(x);
+                data[i] = z / (1.0 + z);
+            }
+        }
+        break;
+    case kTanh:
+        for (size_t i = 0; i < n; i++) {
+            data[i] = std::tanh(data[i]);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+bool KerasLayerActivation::ApplyBatch(const float* in, float* out, int rows,
+                                      int in_size) const {
+    if (in != out) {
+        std::copy(in, in + (size_t)rows * in_size, out);
+    }
+    ApplyInPlace(out, (size_t)rows * in_size);
+
+    return true;
+}
+
 bool KerasLayerDense::LoadLayer(std::istream* file) {
     KASSERT(file, "Invalid file stream");
 
@@ -191,6 +269,105 @@ bool KerasLayerDense::Apply(Tensor* in, Tensor* out) {
     return true;
 }
 
+bool KerasLayerDense::BatchShape(int in_size, int* out_size) const {
+    KASSERT(in_size == weights_.dims_[0], "Dimension mismatch %d %d", in_size,
+            weights_.dims_[0]);
+    *out_size = weights_.dims_[1];
+    return true;
+}
+
+// Blocked GEMM out = in * weights + biases. Each block keeps 4 rows x 8 (4)
+// output columns in registers while streaming over the input dimension. The
+// sums are accumulated in the same order as Apply, so results are identical.
+bool KerasLayerDense::ApplyBatch(const float* in, float* out, int rows,
+                                 int in_size) const {
+    KASSERT(in != out, "Dense layer can not be applied in place");
+    KASSERT(in_size == weights_.dims_[0], "Dimension mismatch %d %d", in_size,
+            weights_.dims_[0]);
+
+    const int out_size = weights_.dims_[1];
+    const float* w = weights_.data_.data();
+    const float* b = biases_.data_.data();
+    const int row_block = 4;
+
+    int r = 0;
+    for (; r + row_block <= rows; r += row_block) {
+        const float* in0 = in + (size_t)r * in_size;
+        float* out0 = out + (size_t)r * out_size;
+        int j = 0;
+#if defined(__AVX__)
+        for (; j + 8 <= out_size; j += 8) {
+            __m256 acc[row_block];
+            for (int k = 0; k < row_block; k++) {
+                acc[k] = _mm256_setzero_ps();
+            }
+            for (int i = 0; i < in_size; i++) {
+                const __m256 wi = _mm256_loadu_ps(w + (size_t)i * out_size + j);
+                for (int k = 0; k < row_block; k++) {
+                    acc[k] = _mm256_add_ps(
+                        acc[k], _mm256_mul_ps(
+                                    _mm256_set1_ps(in0[k * in_size + i]), wi));
+                }
+            }
+            const __m256 bias = _mm256_loadu_ps(b + j);
+            for (int k = 0; k < row_block; k++) {
+                _mm256_storeu_ps(out0 + k * out_size + j,
+                                 _mm256_add_ps(acc[k], bias));
+            }
+        }
+#endif
+#if defined(__SSE2__)
+        for (; j + 4 <= out_size; j += 4) {
+            __m128 acc[row_block];
+            for (int k = 0; k < row_block; k++) {
+                acc[k] = _mm_setzero_ps();
+            }
+            for (int i = 0; i < in_size; i++) {
+                const __m128 wi = _mm_loadu_ps(w + (size_t)i * out_size + j);
+                for (int k = 0; k < row_block; k++) {
+                    acc[k] = _mm_add_ps(
+                        acc[k],
+                        _mm_mul_ps(_mm_set1_ps(in0[k * in_size + i]), wi));
+                }
+            }
+            const __m128 bias = _mm_loadu_ps(b + j);
+            for (int k = 0; k < row_block; k++) {
+                _mm_storeu_ps(out0 + k * out_size + j, _mm_add_ps(acc[k], bias));
+            }
+        }
+#endif
+        for (; j < out_size; j++) {
+            for (int k = 0; k < row_block; k++) {
+                float sum = 0.0;
+                for (int i = 0; i < in_size; i++) {
+                    sum += in0[k * in_size + i] * w[(size_t)i * out_size + j];
+                }
+                out0[k * out_size + j] = sum + b[j];
+            }
+        }
+    }
+    // remaining rows
+    for (; r < rows; r++) {
+        const float* in_row = in + (size_t)r * in_size;
+        float* out_row = out + (size_t)r * out_size;
+        std::fill(out_row, out_row + out_size, 0.0f);
+        for (int i = 0; i < in_size; i++) {
+            const float x = in_row[i];
+            const float* wi = w + (size_t)i * out_size;
+            for (int j = 0; j < out_size; j++) {
+                out_row[j] += x * wi[j];
+            }
+        }
+        for (int j = 0; j < out_size; j++) {
+            out_row[j] += b[j];
+        }
+    }
+
+    activation_.ApplyInPlace(out, (size_t)rows * out_size);
+
+    return true;
+}
+
 bool KerasLayerConvolution2d::LoadLayer(std::istream* file) {
     KASSERT(file, "Invalid file stream");
 
@@ -684,3 +861,56 @@ bool KerasModel::Apply(Tensor* in, Tensor* out) {
 
     return true;
 }
+
+int KerasModel::InputSize() const {
+    if (layers_.empty()) {
+        return 0;
+    }
+    const KerasLayerDense* dense =
+        dynamic_cast<const KerasLayerDense*>(layers_[0]);
+    return (dense != NULL) ? dense->InputSize() : 0;
+}
+
+bool KerasModel::InitBatch(KerasBatch* batch, int input_size,
+                           int batch_size) const {
+    KASSERT(batch, "Invalid batch");
+    KASSERT(batch_size > 0, "Invalid batch size %d", batch_size);
+
+    int size = input_size;
+    int max_size = input_size;
+    for (unsigned int i = 0; i < layers_.size(); i++) {
+        KASSERT(layers_[i]->BatchShape(size, &size),
+                "Layer %d does not support batched inference", i);
+        max_size = std::max(max_size, size);
+    }
+
+    batch->batch_size_ = batch_size;
+    batch->input_size_ = input_size;
+    batch->output_size_ = size;
+    batch->buffers_[0].assign((size_t)batch_size * max_size, 0.0f);
+    batch->buffers_[1].assign((size_t)batch_size * max_size, 0.0f);
+    batch->output_ = batch->buffers_[0].data();
+
+    return true;
+}
+
+bool KerasModel::ApplyBatch(KerasBatch* batch, int rows) const {
+    KASSERT(batch, "Invalid batch");
+    KASSERT(rows <= batch->batch_size_, "Batch too large %d", rows);
+
+    int cur = 0;
+    int size = batch->input_size_;
+    for (unsigned int i = 0; i < layers_.size(); i++) {
+        int out_size = 0;
+        layers_[i]->BatchShape(size, &out_size);
+        const float* in = batch->buffers_[cur].data();
+        float* out = batch->buffers_[1 - cur].data();
+        KASSERT(layers_[i]->ApplyBatch(in, out, rows, size),
+                "Failed to apply layer %d", i);
+        cur = 1 - cur;
+        size = out_size;
+    }
+    batch->output_ = batch->buffers_[cur].data();
+
+    return true;
+}
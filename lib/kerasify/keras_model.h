@@ -275,6 +275,15 @@ class KerasLayer {
     virtual bool LoadLayer(std::istream* file) = 0;
 
     virtual bool Apply(Tensor* in, Tensor* out) = 0;
+
+    // Batched inference on row major rows x in_size matrices, in and out may
+    // alias for layers that keep the shape. Returns false if not supported.
+    virtual bool BatchShape(int in_size, int* out_size) const { return false; }
+
+    virtual bool ApplyBatch(const float* in, float* out, int rows,
+                            int in_size) const {
+        return false;
+    }
 };
 
 class KerasLayerActivation : public KerasLayer {
@@ -296,6 +305,15 @@ class KerasLayerActivation : public KerasLayer {
 
     virtual bool Apply(Tensor* in, Tensor* out);
 
+    virtual bool BatchShape(int in_size, int* out_size) const;
+
+    virtual bool ApplyBatch(const float* in, float* out, int rows,
+                            int in_size) const;
+
+    void ApplyInPlace(float* data, size_t n) const;
+
+    ActivationType Type() const { return activation_type_; }
+
   private:
     ActivationType activation_type_;
 };
@@ -310,7 +328,16 @@ class KerasLayerDense : public KerasLayer {
 
     virtual bool Apply(Tensor* in, Tensor* out);
 
+    virtual bool BatchShape(int in_size, int* out_size) const;
+
+    virtual bool ApplyBatch(const float* in, float* out, int rows,
+                            int in_size) const;
+
+    int InputSize() const { return weights_.dims_[0]; }
+
   private:
+    friend class KerasQuantizedModel;
+
     Tensor weights_;
     Tensor biases_;
 
@@ -421,6 +448,36 @@ class KerasLayerEmbedding : public KerasLayer {
     Tensor weights_;
 };
 
+// Preallocated ping-pong buffers for KerasModel::ApplyBatch. Callers write
+// the features of up to BatchSize() samples into Input(row) and read the
+// results from Output(row) after ApplyBatch.
+class KerasBatch {
+  public:
+    KerasBatch()
+        : batch_size_(0), input_size_(0), output_size_(0), output_(NULL) {}
+
+    int BatchSize() const { return batch_size_; }
+
+    int InputSize() const { return input_size_; }
+
+    int OutputSize() const { return output_size_; }
+
+    float* Input(int row) { return buffers_[0].data() + row * input_size_; }
+
+    const float* Output(int row) const {
+        return output_ + row * output_size_;
+    }
+
+  private:
+    friend class KerasModel;
+
+    int batch_size_;
+    int input_size_;
+    int output_size_;
+    std::vector<float> buffers_[2];
+    float* output_;
+};
+
 class KerasModel {
   public:
     enum LayerType {
@@ -446,7 +503,20 @@ class KerasModel {
 
     virtual bool Apply(Tensor* in, Tensor* out);
 
+    // Number of input features of a model starting with a dense layer, 0
+    // otherwise.
+    int InputSize() const;
+
+    // Allocate buffers for batches of up to batch_size samples with
+    // input_size features. Fails if a layer does not support batching.
+    bool InitBatch(KerasBatch* batch, int input_size, int batch_size) const;
+
+    // The inputs of the batch may be overwritten.
+    bool ApplyBatch(KerasBatch* batch, int rows) const;
+
   private:
+    friend class KerasQuantizedModel;
+
     std::vector<KerasLayer*> layers_;
 };
 
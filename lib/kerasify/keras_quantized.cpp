@@ -0,0 +1,171 @@
+#include "keras_quantized.h"
+
+#include <cmath>
+#include <stdio.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+static const int kQuantizedStride = 32;
+#else
+static const int kQuantizedStride = 16;
+#endif
+
+bool KerasQuantizedModel::Quantize(const KerasModel& model, int input_size,
+                                   int float_inputs) {
+    KASSERT(float_inputs >= 0 && float_inputs <= input_size,
+            "Invalid number of fp32 inputs %d", float_inputs);
+
+    layers_.clear();
+    input_size_ = input_size;
+    float_inputs_ = float_inputs;
+    max_size_ = input_size;
+
+    int size = input_size;
+    for (unsigned int l = 0; l < model.layers_.size(); l++) {
+        const KerasLayerDense* dense =
+            dynamic_cast<const KerasLayerDense*>(model.layers_[l]);
+        KASSERT(dense, "Layer %d is not a dense layer", l);
+        const int rows = dense->weights_.dims_[0];
+        const int cols = dense->weights_.dims_[1];
+        KASSERT(rows == size, "Dimension mismatch %d %d", rows, size);
+
+        KerasLayerActivation::ActivationType type = dense->activation_.Type();
+        const bool last = (l + 1 == model.layers_.size());
+        KASSERT(last || type == KerasLayerActivation::kRelu ||
+                    type == KerasLayerActivation::kSigmoid ||
+                    type == KerasLayerActivation::kSoftPlus ||
+                    type == KerasLayerActivation::kHardSigmoid,
+                "Layer %d has a activation with negative values", l);
+
+        Layer layer;
+        layer.in_size = rows;
+        layer.out_size = cols;
+        layer.float_inputs = (l == 0) ? float_inputs : 0;
+        layer.in_stride = ((rows - layer.float_inputs + kQuantizedStride - 1) /
+                           kQuantizedStride) * kQuantizedStride;
+        layer.biases = dense->biases_.data_;
+        layer.activation = dense->activation_;
+
+        const std::vector<float>& w = dense->weights_.data_;
+        // transposed so that each output is a contiguous dot product
+        layer.weights.assign((size_t)cols * layer.in_stride, 0);
+        layer.scales.assign(cols, 1.0f);
+        for (int j = 0; j < cols; j++) {
+            float max_weight = 0.0f;
+            for (int i = layer.float_inputs; i < rows; i++) {
+                max_weight = std::max(max_weight, std::fabs(w[i * cols + j]));
+            }
+            if (max_weight > 0.0f) {
+                layer.scales[j] = max_weight / 127.0f;
+            }
+            for (int i = layer.float_inputs; i < rows; i++) {
+                float q = std::round(w[i * cols + j] / layer.scales[j]);
+                q = std::min(127.0f, std::max(-127.0f, q));
+                layer.weights[(size_t)j * layer.in_stride +
+                              (i - layer.float_inputs)] = (int8_t)q;
+            }
+        }
+        layer.float_weights.assign(w.begin(),
+                                   w.begin() + layer.float_inputs * cols);
+
+        layers_.push_back(layer);
+        size = cols;
+        max_size_ = std::max(max_size_, std::max(layer.in_stride, cols));
+    }
+    KASSERT(layers_.size() > 0, "Empty model");
+
+    return true;
+}
+
+static inline int32_t DotU8S8(const uint8_t* x, const int8_t* w, int n) {
+    int32_t sum = 0;
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + 32 <= n; i += 32) {
+        __m256i xv = _mm256_loadu_si256((const __m256i*)(x + i));
+        __m256i wv = _mm256_loadu_si256((const __m256i*)(w + i));
+        acc = _mm256_add_epi32(
+            acc, _mm256_madd_epi16(_mm256_maddubs_epi16(xv, wv), ones));
+    }
+    __m128i acc128 = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                                   _mm256_extracti128_si256(acc, 1));
+    acc128 = _mm_add_epi32(acc128, _mm_shuffle_epi32(acc128, 0x4E));
+    acc128 = _mm_add_epi32(acc128, _mm_shuffle_epi32(acc128, 0xB1));
+    sum = _mm_cvtsi128_si32(acc128);
+#elif defined(__SSSE3__)
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        __m128i xv = _mm_loadu_si128((const __m128i*)(x + i));
+        __m128i wv = _mm_loadu_si128((const __m128i*)(w + i));
+        acc = _mm_add_epi32(acc,
+                            _mm_madd_epi16(_mm_maddubs_epi16(xv, wv), ones));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));
+    sum = _mm_cvtsi128_si32(acc);
+#endif
+    for (; i < n; i++) {
+        sum += (int32_t)x[i] * (int32_t)w[i];
+    }
+    return sum;
+}
+
+bool KerasQuantizedModel::Apply(const float* in, float* out,
+                                Buffer* buffer) const {
+    KASSERT(buffer, "Invalid buffer");
+    KASSERT(layers_.size() > 0, "Model is not quantized");
+    if ((int)buffer->quantized_.size() < max_size_) {
+        buffer->quantized_.assign(max_size_, 0);
+        buffer->values_[0].assign(max_size_, 0.0f);
+        buffer->values_[1].assign(max_size_, 0.0f);
+    }
+
+    const float* layer_in = in;
+    int cur = 0;
+    for (size_t l = 0; l < layers_.size(); l++) {
+        const Layer& layer = layers_[l];
+        const float* x = layer_in + layer.float_inputs;
+        const int n = layer.in_size - layer.float_inputs;
+
+        float max_value = 0.0f;
+        for (int i = 0; i < n; i++) {
+            max_value = std::max(max_value, x[i]);
+        }
+        const float in_scale = (max_value > 0.0f) ? max_value / 127.0f : 1.0f;
+        const float inv_scale = 1.0f / in_scale;
+        uint8_t* q = buffer->quantized_.data();
+        for (int i = 0; i < n; i++) {
+            q[i] = (uint8_t)std::min(127.0f, std::max(0.0f, x[i] * inv_scale + 0.5f));
+        }
+        std::fill(q + n, q + layer.in_stride, 0);
+
+        float* y = buffer->values_[cur].data();
+        for (int j = 0; j < layer.out_size; j++) {
+            float sum = 0.0f;
+            for (int i = 0; i < layer.float_inputs; i++) {
+                sum += layer_in[i] * layer.float_weights[i * layer.out_size + j];
+            }
+            const int32_t dot =
+                DotU8S8(q, layer.weights.data() + (size_t)j * layer.in_stride,
+                        layer.in_stride);
+            y[j] = sum + (float)dot * (in_scale * layer.scales[j]) + layer.biases[j];
+        }
+        layer.activation.ApplyInPlace(y, layer.out_size);
+
+        layer_in = y;
+        cur = 1 - cur;
+    }
+
+    const Layer& last = layers_.back();
+    std::copy(layer_in, layer_in + last.out_size, out);
+
+    return true;
+}
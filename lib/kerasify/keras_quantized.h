@@ -0,0 +1,54 @@
+#ifndef KERAS_QUANTIZED_H_
+#define KERAS_QUANTIZED_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "keras_model.h"
+
+// Int8 inference for sequential models of dense layers with non-negative
+// activations (relu, sigmoid, ...). Weights are quantized symmetrically per
+// output to [-127, 127], layer inputs dynamically per sample to [0, 127]
+// (7 bit, so pmaddubsw can not saturate) and accumulated in int32. The first
+// float_inputs features are kept in fp32, they may be unbounded (e.g. length).
+class KerasQuantizedModel {
+  public:
+    // Scratch memory of one thread
+    class Buffer {
+      private:
+        friend class KerasQuantizedModel;
+
+        std::vector<uint8_t> quantized_;
+        std::vector<float> values_[2];
+    };
+
+    KerasQuantizedModel() : input_size_(0), float_inputs_(0), max_size_(0) {}
+
+    bool Quantize(const KerasModel& model, int input_size, int float_inputs);
+
+    // Inputs besides the first float_inputs ones have to be non-negative
+    bool Apply(const float* in, float* out, Buffer* buffer) const;
+
+  private:
+    struct Layer {
+        int in_size;
+        int in_stride;
+        int out_size;
+        // per output
+        std::vector<float> scales;
+        // out_size x in_stride, zero padded
+        std::vector<int8_t> weights;
+        // in_size x out_size fp32 weights of the unquantized inputs
+        std::vector<float> float_weights;
+        int float_inputs;
+        std::vector<float> biases;
+        KerasLayerActivation activation;
+    };
+
+    std::vector<Layer> layers_;
+    int input_size_;
+    int float_inputs_;
+    int max_size_;
+};
+
+#endif // KERAS_QUANTIZED_H_
@@ -17,4 +17,11 @@ extern int mergereads(int argc, const char** argv, const Command &command);
 extern int findassemblystart(int argc, const char** argv, const Command &command);
 extern int cyclecheck(int argc, const char** argv, const Command &command);
 extern int createhdb(int argc, const char** argv, const Command &command);
+extern int filterabsorbed(int argc, const char** argv, const Command &command);
+extern int maskinterior(int argc, const char** argv, const Command &command);
+extern int selectbyscore(int argc, const char** argv, const Command &command);
+extern int benchmarkfilter(int argc, const char** argv, const Command &command);
+extern int readorfs(int argc, const char** argv, const Command &command);
+extern int virtualconcatdbs(int argc, const char** argv, const Command &command);
+extern int selectentries(int argc, const char** argv, const Command &command);
 #endif
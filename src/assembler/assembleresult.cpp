@@ -1,4 +1,6 @@
 #include "LocalParameters.h"
+#include "ProteinFilter.h"
+#include "AssemblyStats.h"
 #include "DistanceCalculator.h"
 #include "Matcher.h"
 #include "DBReader.h"
@@ -128,6 +130,30 @@ int doassembly(LocalParameters &par) {
     SubstitutionMatrix::FastMatrix fastMatrix = SubstitutionMatrix::createAsciiSubMat(*subMat);
     EvalueComputation evaluer(sequenceDbr->getAminoAcidDBSize(), subMat);
 
+    // protein filter for pruning fragments and/or filtering the final assembly
+    ProteinFilter *filter = NULL;
+    DBWriter *scoreWriter = NULL;
+    const bool filterAssembly = par.filterAssembly && Parameters::isEqualDbtype(seqType, Parameters::DBTYPE_NUCLEOTIDES) == false;
+    const bool prune = par.pruneThreshold > 0.0f && Parameters::isEqualDbtype(seqType, Parameters::DBTYPE_NUCLEOTIDES) == false;
+    if ((par.filterAssembly || par.pruneThreshold > 0.0f) && Parameters::isEqualDbtype(seqType, Parameters::DBTYPE_NUCLEOTIDES)) {
+        Debug(Debug::WARNING) << "Protein filter is only possible for amino acid sequences\n";
+    }
+    if (filterAssembly || prune) {
+        filter = new ProteinFilter(par.scoringMatrixFile.aminoacids, par.filterModel, par.proteinFilterQuant);
+    }
+    // with written scores every entry is kept, the selection is left to selectbyscore
+    if (filterAssembly && par.writeScores) {
+        std::string scoreData = par.db3 + "_scores";
+        std::string scoreIndex = par.db3 + "_scores.index";
+        scoreWriter = new DBWriter(scoreData.c_str(), scoreIndex.c_str(), par.threads, false, Parameters::DBTYPE_GENERIC_DB);
+        scoreWriter->open();
+    }
+    size_t rejectedCnt = 0;
+    size_t extendedCnt = 0;
+    size_t inputResidues = 0;
+    size_t addedResidues = 0;
+    size_t writtenCnt = 0;
+
     unsigned char * wasExtended = new unsigned char[sequenceDbr->getSize()];
     std::fill(wasExtended, wasExtended+sequenceDbr->getSize(), 0);
     Debug::Progress progress(sequenceDbr->getSize());
@@ -138,11 +164,12 @@ int doassembly(LocalParameters &par) {
         thread_idx = (unsigned int) omp_get_thread_num();
 #endif
 
+        ProteinFilter::Scorer *scorer = (filter != NULL) ? new ProteinFilter::Scorer(*filter) : NULL;
         std::vector<Matcher::result_t> alignments;
         alignments.reserve(300);
         bool *useReverse = new bool[sequenceDbr->getSize()];
         std::fill(useReverse, useReverse+sequenceDbr->getSize(), false);
-#pragma omp for schedule(dynamic, 100)
+#pragma omp for schedule(dynamic, 100) reduction(+:rejectedCnt, extendedCnt, inputResidues, addedResidues, writtenCnt)
         for (size_t id = 0; id < sequenceDbr->getSize(); id++) {
             progress.updateProgress();
 
@@ -150,6 +177,7 @@ int doassembly(LocalParameters &par) {
             char *querySeq = sequenceDbr->getData(id, thread_idx);
             unsigned int querySeqLen = sequenceDbr->getSeqLen(id);
             std::string query(querySeq, querySeqLen); // no /n/0
+            inputResidues += querySeqLen;
 
             char *alnData = alnReader->getDataByDBKey(queryKey, thread_idx);
             alignments.clear();
@@ -314,35 +342,96 @@ int doassembly(LocalParameters &par) {
             }
 
             if (queryCouldBeExtended)  {
-                query.push_back('\n');
                 __sync_or_and_fetch(&wasExtended[id], static_cast<unsigned char>(0x20));
+                extendedCnt++;
+                addedResidues += query.size() - sequenceDbr->getSeqLen(id);
+                if (filterAssembly) {
+                    const float score = scorer->score(query.c_str(), query.size());
+                    if (scoreWriter != NULL) {
+                        scoreWriter->writeData(reinterpret_cast<const char *>(&score), sizeof(float), queryKey, thread_idx);
+                    } else if (score <= par.proteinFilterThreshold) {
+                        rejectedCnt++;
+                        continue;
+                    }
+                }
+                query.push_back('\n');
                 resultWriter.writeData(query.c_str(), query.size(), queryKey, thread_idx);
+                writtenCnt++;
             }
 
         }
+        delete scorer;
     } // end parallel
 
+    size_t prunedCnt = 0;
+
 // add sequences that are not yet assembled
-#pragma omp parallel for schedule(dynamic, 10000)
-    for (size_t id = 0; id < sequenceDbr->getSize(); id++) {
+#pragma omp parallel
+    {
         unsigned int thread_idx = 0;
 #ifdef OPENMP
         thread_idx = (unsigned int) omp_get_thread_num();
 #endif
-        //bool couldExtend =  (wasExtended[id] & 0x10);
-        bool isNotContig =  !(wasExtended[id] & 0x20);
-        //bool wasNotUsed =  !(wasExtended[id] & 0x40);
-        //bool wasNotExtended =  !(wasExtended[id] & 0x80);
-        //bool wasUsed    =  (wasExtended[id] & 0x40);
-        //if(isNotContig && wasNotExtended ){
-        if (isNotContig){
-            char *querySeqData = sequenceDbr->getData(id, thread_idx);
-            resultWriter.writeData(querySeqData, sequenceDbr->getEntryLen(id)-1, sequenceDbr->getDbKey(id), thread_idx);
+        ProteinFilter::Scorer *scorer = (filter != NULL) ? new ProteinFilter::Scorer(*filter) : NULL;
+
+#pragma omp for schedule(dynamic, 10000) reduction(+:prunedCnt, rejectedCnt, writtenCnt)
+        for (size_t id = 0; id < sequenceDbr->getSize(); id++) {
+            bool couldExtend =  (wasExtended[id] & 0x10);
+            bool isNotContig =  !(wasExtended[id] & 0x20);
+            //bool wasNotUsed =  !(wasExtended[id] & 0x40);
+            //bool wasNotExtended =  !(wasExtended[id] & 0x80);
+            //bool wasUsed    =  (wasExtended[id] & 0x40);
+            //if(isNotContig && wasNotExtended ){
+            if (isNotContig){
+                char *querySeqData = sequenceDbr->getData(id, thread_idx);
+                unsigned int dbKey = sequenceDbr->getDbKey(id);
+                const bool pruneCandidate = prune && couldExtend == false;
+                float score = 0.0f;
+                if (pruneCandidate || filterAssembly) {
+                    score = scorer->score(querySeqData, sequenceDbr->getSeqLen(id));
+                }
+                // fragments that took no part in an extension and look non-coding do not reach the next iteration
+                if (pruneCandidate && score < par.pruneThreshold) {
+                    prunedCnt++;
+                    continue;
+                }
+                if (filterAssembly) {
+                    if (scoreWriter != NULL) {
+                        scoreWriter->writeData(reinterpret_cast<const char *>(&score), sizeof(float), dbKey, thread_idx);
+                    } else if (score <= par.proteinFilterThreshold) {
+                        rejectedCnt++;
+                        continue;
+                    }
+                }
+                resultWriter.writeData(querySeqData, sequenceDbr->getEntryLen(id)-1, dbKey, thread_idx);
+                writtenCnt++;
+            }
         }
+        delete scorer;
     }
+    if (prune) {
+        Debug(Debug::INFO) << "Pruned " << prunedCnt << " non-coding fragments\n";
+    }
+    if (filterAssembly && scoreWriter == NULL) {
+        Debug(Debug::INFO) << "Protein filter removed " << rejectedCnt << " entries\n";
+    }
+    if (scoreWriter != NULL) {
+        scoreWriter->close(true);
+        delete scoreWriter;
+    }
+    delete filter;
 
     // cleanup
     resultWriter.close(true);
+
+    AssemblyStats stats;
+    stats.queries = sequenceDbr->getSize();
+    stats.extended = extendedCnt;
+    stats.inputResidues = inputResidues;
+    stats.addedResidues = addedResidues;
+    stats.written = writtenCnt;
+    stats.write(par.db3, par.convergeThreshold);
+
     alnReader->close();
     delete [] wasExtended;
     delete alnReader;
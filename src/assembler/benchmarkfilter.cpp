@@ -0,0 +1,100 @@
+#include "DBReader.h"
+#include "Debug.h"
+#include "Util.h"
+#include "LocalParameters.h"
+#include "ProteinFilter.h"
+
+#include <cmath>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+// feature extraction and inference of all sequences, returns the wall time in seconds
+static double scoreAll(const ProteinFilter &filter, DBReader<unsigned int> &seqDb, std::vector<float> &scores) {
+    const size_t batchSize = 256;
+    const size_t batchCnt = (seqDb.getSize() + batchSize - 1) / batchSize;
+    scores.resize(seqDb.getSize());
+
+    KerasTimer timer;
+    timer.Start();
+#pragma omp parallel
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+        KerasBatch batch;
+        if (filter.initBatch(&batch, batchSize) == false) {
+            Debug(Debug::ERROR) << "Could not initialize protein filter model\n";
+            EXIT(EXIT_FAILURE);
+        }
+        KerasQuantizedModel::Buffer quantBuffer;
+        ProteinFilterFeatures *features = filter.createFeatures();
+
+#pragma omp for schedule(dynamic, 1)
+        for (size_t batchIdx = 0; batchIdx < batchCnt; batchIdx++) {
+            const size_t batchStart = batchIdx * batchSize;
+            const size_t batchEnd = std::min(batchStart + batchSize, seqDb.getSize());
+            for (size_t id = batchStart; id < batchEnd; id++) {
+                filter.extract(features, seqDb.getData(id, thread_idx), seqDb.getSeqLen(id), batch.Input(id - batchStart));
+            }
+            filter.predictRows(&batch, &quantBuffer, batchEnd - batchStart, &scores[batchStart]);
+        }
+        delete features;
+    }
+    return timer.Stop();
+}
+
+int benchmarkfilter(int argc, const char **argv, const Command& command) {
+    LocalParameters& par = LocalParameters::getLocalInstance();
+    par.parseParameters(argc, argv, command, true, 0, 0);
+
+    DBReader<unsigned int> seqDb(par.db1.c_str(), par.db1Index.c_str(), par.threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
+    seqDb.open(DBReader<unsigned int>::NOSORT);
+    if (seqDb.getSize() == 0) {
+        Debug(Debug::ERROR) << "Sequence database " << par.db1 << " is empty\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    ProteinFilter filter(par.scoringMatrixFile.aminoacids, par.filterModel, par.proteinFilterQuant);
+    ProteinFilter reference(par.scoringMatrixFile.aminoacids, par.referenceModel, false);
+
+    // touch all entries once so that both models see the same page cache state
+    std::vector<float> scores;
+    scoreAll(filter, seqDb, scores);
+
+    std::vector<float> referenceScores;
+    const double referenceTime = scoreAll(reference, seqDb, referenceScores);
+    const double filterTime = scoreAll(filter, seqDb, scores);
+
+    size_t agree = 0;
+    size_t accepted = 0;
+    size_t referenceAccepted = 0;
+    double sumDiff = 0.0;
+    float maxDiff = 0.0f;
+    for (size_t id = 0; id < seqDb.getSize(); id++) {
+        const bool accept = scores[id] > par.proteinFilterThreshold;
+        const bool referenceAccept = referenceScores[id] > par.proteinFilterThreshold;
+        agree += (accept == referenceAccept);
+        accepted += accept;
+        referenceAccepted += referenceAccept;
+        const float diff = std::fabs(scores[id] - referenceScores[id]);
+        sumDiff += diff;
+        maxDiff = std::max(maxDiff, diff);
+    }
+
+    const double size = static_cast<double>(seqDb.getSize());
+    Debug(Debug::INFO) << "Model " << par.filterModel << (par.proteinFilterQuant ? " (int8)" : "") << ": "
+                       << size / filterTime / par.threads << " sequences per second per thread, "
+                       << 100.0 * accepted / size << "% accepted\n";
+    Debug(Debug::INFO) << "Reference " << par.referenceModel << ": "
+                       << size / referenceTime / par.threads << " sequences per second per thread, "
+                       << 100.0 * referenceAccepted / size << "% accepted\n";
+    Debug(Debug::INFO) << "Agreement at threshold " << par.proteinFilterThreshold << ": "
+                       << 100.0 * agree / size << "% of " << seqDb.getSize() << " sequences, mean score difference "
+                       << sumDiff / size << ", max. score difference " << maxDiff << "\n";
+
+    seqDb.close();
+    return EXIT_SUCCESS;
+}
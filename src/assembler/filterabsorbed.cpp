@@ -0,0 +1,107 @@
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Debug.h"
+#include "Util.h"
+#include "Orf.h"
+#include "LocalParameters.h"
+
+#include <algorithm>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+// Keeps only reads that are not covered by an ORF absorbed into a protein level contig. A read
+// with untranslated flanks beyond its absorbed ORF is kept, the nucleotide level assembly can use
+// the flanks to extend contigs past the ORF ends. The absorbed ORF keys are taken from the index
+// of one or more absorbedDBs, as written by hybridassembleresults --skip-absorbed-reads.
+int filterabsorbed(int argc, const char **argv, const Command& command) {
+    LocalParameters &par = LocalParameters::getLocalInstance();
+    par.parseParameters(argc, argv, command, true, Parameters::PARSE_VARIADIC, 0);
+    if (par.filenames.size() < 4) {
+        Debug(Debug::ERROR) << "filterabsorbed needs at least one absorbedDB\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    std::vector<std::string> absorbedDbs(par.filenames.begin() + 2, par.filenames.end() - 1);
+    const std::string readDb = par.filenames[0];
+    const std::string orfHeaderDb = par.filenames[1];
+    const std::string outDb = par.filenames.back();
+
+    DBReader<unsigned int> readDbr(readDb.c_str(), (readDb + ".index").c_str(), par.threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
+    readDbr.open(DBReader<unsigned int>::NOSORT);
+
+    DBReader<unsigned int> orfHeaderDbr(orfHeaderDb.c_str(), (orfHeaderDb + ".index").c_str(), par.threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
+    orfHeaderDbr.open(DBReader<unsigned int>::NOSORT);
+
+    DBWriter resultWriter(outDb.c_str(), (outDb + ".index").c_str(), par.threads, par.compressed, readDbr.getDbtype());
+    resultWriter.open();
+
+    unsigned char *wasAbsorbed = new unsigned char[readDbr.getSize()];
+    std::fill(wasAbsorbed, wasAbsorbed + readDbr.getSize(), 0);
+
+    for (size_t i = 0; i < absorbedDbs.size(); i++) {
+        DBReader<unsigned int> absorbedDbr(absorbedDbs[i].c_str(), (absorbedDbs[i] + ".index").c_str(), 1, DBReader<unsigned int>::USE_INDEX);
+        absorbedDbr.open(DBReader<unsigned int>::NOSORT);
+#pragma omp parallel
+        {
+            unsigned int thread_idx = 0;
+#ifdef OPENMP
+            thread_idx = (unsigned int) omp_get_thread_num();
+#endif
+
+#pragma omp for schedule(static)
+            for (size_t id = 0; id < absorbedDbr.getSize(); id++) {
+                unsigned int orfKey = absorbedDbr.getDbKey(id);
+                char *orfHeader = orfHeaderDbr.getDataByDBKey(orfKey, thread_idx);
+                if (orfHeader == NULL) {
+                    Debug(Debug::WARNING) << "Could not find header of ORF " << orfKey << "\n";
+                    continue;
+                }
+                Orf::SequenceLocation loc = Orf::parseOrfHeader(orfHeader);
+                size_t readId = readDbr.getId(loc.id);
+                if (readId == UINT_MAX) {
+                    continue;
+                }
+                // reverse strand ORFs have from > to, less than a codon can be left at either end
+                const size_t readLen = readDbr.getSeqLen(readId);
+                const size_t orfStart = std::min(loc.from, loc.to);
+                const size_t orfEnd = std::max(loc.from, loc.to);
+                if (orfStart < 3 && orfEnd + 3 >= readLen) {
+                    __sync_or_and_fetch(&wasAbsorbed[readId], static_cast<unsigned char>(0x1));
+                }
+            }
+        }
+        absorbedDbr.close();
+    }
+
+#pragma omp parallel
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = (unsigned int) omp_get_thread_num();
+#endif
+
+#pragma omp for schedule(dynamic, 10000)
+        for (size_t id = 0; id < readDbr.getSize(); id++) {
+            if (wasAbsorbed[id] == 0) {
+                char *readData = readDbr.getData(id, thread_idx);
+                unsigned int readLen = readDbr.getEntryLen(id) - 1; //skip null byte
+                resultWriter.writeData(readData, readLen, readDbr.getDbKey(id), thread_idx);
+            }
+        }
+    }
+
+    size_t absorbedCount = 0;
+    for (size_t id = 0; id < readDbr.getSize(); id++) {
+        absorbedCount += (wasAbsorbed[id] != 0);
+    }
+    Debug(Debug::INFO) << absorbedCount << " out of " << readDbr.getSize() << " reads are absorbed by contigs\n";
+
+    resultWriter.close();
+    delete [] wasAbsorbed;
+    orfHeaderDbr.close();
+    readDbr.close();
+
+    return EXIT_SUCCESS;
+}
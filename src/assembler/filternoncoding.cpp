@@ -1,23 +1,11 @@
-#include "ReducedMatrix.h"
-#include "Indexer.h"
-#include "Sequence.h"
-#include "SubstitutionMatrix.h"
-
 #include "Debug.h"
-#include "AminoAcidLookupTables.h"
 #include "DBReader.h"
 #include "DBWriter.h"
 
 #include "LocalParameters.h"
-
-#include "kerasify/keras_model.h"
-//#include "predict_coding_acc9540_57x32x64.model.h"
-//#include "predict_coding_acc9642_57x32x64.model.h"
-//#include "predict_coding_acc9598_57x32x64.model.h"
-#include "predict_coding_acc9743_57x32x64.model.h"
-
-//#include "predict_coding_acc9260_56x96.model.h"
-//#include "predict_coding_acc9623_57x32x64.model.h"
+#include "ProteinFilter.h"
+#include "ProteinFilterCascade.h"
+#include "OverlayDBWriter.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -32,19 +20,79 @@ int filternoncoding(int argc, const char **argv, const Command& command)  {
     seqDb.open(DBReader<unsigned int>::NOSORT);
 
     Debug(Debug::INFO) << "Output file: " << par.db2 << "\n";
-    DBWriter dbw(par.db2.c_str(), par.db2Index.c_str(), static_cast<unsigned int>(par.threads), par.compressed, seqDb.getDbtype());
+    // only the empty placeholders of rejected entries are written, accepted entries are taken from the input
+    OverlayDBWriter::checkCompression(par.PARAM_COMPRESSED.wasSet, par.compressed, seqDb);
+    OverlayDBWriter dbw(seqDb, par.db2.c_str(), par.db2Index.c_str(), static_cast<unsigned int>(par.threads), seqDb.getDbtype());
     dbw.open();
 
-    // Initialize model.
-    KerasModel model;
-//    model.LoadModel(std::string((const char *)predict_coding_acc9623_57x32x64_model, predict_coding_acc9623_57x32x64_model_len));
-    model.LoadModel(std::string((const char *)predict_coding_acc9743_57x32x64_model, predict_coding_acc9743_57x32x64_model_len));
+    DBWriter *scoreWriter = NULL;
+    if (par.writeScores) {
+        std::string scoreData = par.db2 + "_scores";
+        std::string scoreIndex = par.db2 + "_scores.index";
+        Debug(Debug::INFO) << "Score file: " << scoreData << "\n";
+        scoreWriter = new DBWriter(scoreData.c_str(), scoreIndex.c_str(), static_cast<unsigned int>(par.threads), false, Parameters::DBTYPE_GENERIC_DB);
+        scoreWriter->open();
+    }
 
-    SubstitutionMatrix subMat(par.scoringMatrixFile.aminoacids, 2.0, 0.0);
-    ReducedMatrix redMat7(subMat.probMatrix, subMat.subMatrixPseudoCounts, subMat.aa2num, subMat.num2aa, subMat.alphabetSize, 7, subMat.getBitFactor());
-//    ReducedMatrix redMat3(subMat.probMatrix, subMat.subMatrixPseudoCounts, subMat.aa2int, subMat.int2aa, subMat.alphabetSize, 3, subMat.getBitFactor());
+    // Initialize model.
+    ProteinFilter filter(par.scoringMatrixFile.aminoacids, par.filterModel, par.proteinFilterQuant);
+    const KerasModel &model = filter.getModel();
+
+    // features: (length,) 20 amino acid and 36 reduced dipeptide frequencies
+    const int featureCnt = filter.getInputSize();
+    const size_t batchSize = 256;
+    const size_t batchCnt = (seqDb.getSize() + batchSize - 1) / batchSize;
+
+    // calibrate the cascade on an evenly spaced sample of the input
+    ProteinFilterCascade cascade;
+    if (par.proteinFilterCascade && par.writeScores) {
+        Debug(Debug::WARNING) << "Protein filter cascade is disabled since all scores have to be written\n";
+    } else if (par.proteinFilterCascade && filter.usesAllFeatures() == false) {
+        Debug(Debug::WARNING) << "Protein filter cascade is disabled since the model does not use the length feature\n";
+    } else if (par.proteinFilterCascade) {
+        const size_t maxSampleCnt = 16384;
+        // rounded up, so that at most maxSampleCnt sequences are sampled
+        const size_t sampleStride = std::max(static_cast<size_t>(1), (seqDb.getSize() + maxSampleCnt - 1) / maxSampleCnt);
+        const size_t sampleCnt = (seqDb.getSize() + sampleStride - 1) / sampleStride;
+        std::vector<float> sampleFeatures(sampleCnt * featureCnt);
+        std::vector<float> sampleScores(sampleCnt);
+#pragma omp parallel
+        {
+            unsigned int thread_idx = 0;
+#ifdef OPENMP
+            thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+            KerasBatch batch;
+            if (filter.initBatch(&batch, batchSize) == false) {
+                Debug(Debug::ERROR) << "Could not initialize protein filter model\n";
+                EXIT(EXIT_FAILURE);
+            }
+            KerasQuantizedModel::Buffer quantBuffer;
+            ProteinFilterFeatures *features = filter.createFeatures();
+#pragma omp for schedule(dynamic, 1)
+            for (size_t sampleStart = 0; sampleStart < sampleCnt; sampleStart += batchSize) {
+                const size_t rows = std::min(batchSize, sampleCnt - sampleStart);
+                for (size_t row = 0; row < rows; row++) {
+                    const size_t id = (sampleStart + row) * sampleStride;
+                    filter.extract(features, seqDb.getData(id, thread_idx), seqDb.getSeqLen(id), batch.Input(row));
+                    std::copy(batch.Input(row), batch.Input(row) + featureCnt, &sampleFeatures[(sampleStart + row) * featureCnt]);
+                }
+                filter.predictRows(&batch, &quantBuffer, rows, &sampleScores[sampleStart]);
+            }
+            delete features;
+        }
+        cascade.calibrate(sampleFeatures, sampleScores, par.proteinFilterThreshold, par.proteinFilterCascadeError);
+        Debug(Debug::INFO) << "Calibrated protein filter cascade on " << sampleCnt << " sequences\n";
+    }
 
-    // Create a 1D Tensor on length 20 for input data.
+    // every checkBatchStride-th batch is completely scored by the network (and in fp32) to report the agreement
+    const size_t checkBatchStride = 64;
+    size_t checkCnt = 0;
+    size_t checkAgree = 0;
+    float checkMaxDiff = 0.0f;
+    size_t cascadeCheckCnt = 0;
+    size_t cascadeCheckAgree = 0;
+    size_t decisionCnt[ProteinFilterCascade::DECISION_CNT] = {};
 #pragma omp parallel
     {
         unsigned int thread_idx = 0;
@@ -52,131 +100,119 @@ int filternoncoding(int argc, const char **argv, const Command& command)  {
         thread_idx = static_cast<unsigned int>(omp_get_thread_num());
 #endif
 
-        Tensor in(56);
-        float counter[255];
-        std::fill(counter, counter + 255, 1.0);
-        Sequence seq(par.maxSeqLen, seqDb.getDbtype(), &subMat,  par.kmerSize, false, false);
-        Sequence rseq2mer(par.maxSeqLen, seqDb.getDbtype(), &redMat7, 2, false, false);
-//        Sequence rseq5mer(par.maxSeqLen, Sequence::AMINO_ACIDS, &redMat3, 5, false, false);
-        Indexer indexerDi(redMat7.alphabetSize, 2);
-//        Indexer indexerPenta(redMat3.alphabetSize, 5);
-        float *diAACnt = new float[redMat7.alphabetSize * redMat7.alphabetSize];
-        std::fill(diAACnt, diAACnt + redMat7.alphabetSize * redMat7.alphabetSize, 1.0);
-//        int pentaIdxRange = MathUtil::ipow<size_t>(redMat3.alphabetSize, 5);
-//        float *pentaAACnt = new float[pentaIdxRange];
-//        std::fill(pentaAACnt, pentaAACnt + pentaIdxRange, 1.0);
-        Charges charge;
-        Doolittle doolittle;
-
-#pragma omp for schedule(static)
-        for (size_t id = 0; id < seqDb.getSize(); id++) {
-            std::vector<float> data;
-            char *seqData = seqDb.getData(id, thread_idx);
-            unsigned int dbKey = seqDb.getDbKey(id);
-            unsigned int seqLen = seqDb.getSeqLen(id);
-            seq.mapSequence(id, dbKey, seqData, seqLen);
-//            printf("%5d ", seq.L);
-//            float chargeFlt = Util::averageValueOnAminoAcids(charge.values, seqData);
-//            float doolittleFlt = Util::averageValueOnAminoAcids(doolittle.values, seqData);
-//            printf("%3f ", chargeFlt);
-//            printf("%3f ", doolittleFlt);
-            float totalAACnt = 0;
-            data.push_back(static_cast<float>(seq.L));
-            for (int pos = 0; pos < seq.L; pos++) {
-                if (seq.numSequence[pos] < subMat.alphabetSize - 1) {
-                    counter[seq.numSequence[pos]] += 1.0;
-                    totalAACnt += 1.0;
+        KerasBatch batch;
+        if (filter.initBatch(&batch, batchSize) == false) {
+            Debug(Debug::ERROR) << "Could not initialize protein filter model\n";
+            EXIT(EXIT_FAILURE);
+        }
+        std::vector<float> scores(batchSize);
+        std::vector<unsigned char> accept(batchSize);
+        std::vector<ProteinFilterCascade::Decision> decisions(batchSize, ProteinFilterCascade::UNDECIDED);
+        // batch row of each network input row
+        std::vector<size_t> netRowIdx(batchSize);
+        KerasQuantizedModel::Buffer quantBuffer;
+        size_t threadCheckCnt = 0;
+        size_t threadCheckAgree = 0;
+        float threadCheckMaxDiff = 0.0f;
+        size_t threadCascadeCheckCnt = 0;
+        size_t threadCascadeCheckAgree = 0;
+        size_t threadDecisionCnt[ProteinFilterCascade::DECISION_CNT] = {};
+        ProteinFilterFeatures *features = filter.createFeatures();
+
+#pragma omp for schedule(dynamic, 1)
+        for (size_t batchIdx = 0; batchIdx < batchCnt; batchIdx++) {
+            const size_t batchStart = batchIdx * batchSize;
+            const size_t batchEnd = std::min(batchStart + batchSize, seqDb.getSize());
+            const size_t rows = batchEnd - batchStart;
+            const bool checkBatch = (batchIdx % checkBatchStride == 0);
+            for (size_t id = batchStart; id < batchEnd; id++) {
+                char *seqData = seqDb.getData(id, thread_idx);
+                unsigned int seqLen = seqDb.getSeqLen(id);
+                filter.extract(features, seqData, seqLen, batch.Input(id - batchStart));
+            }
+
+            // cascade decisions, undecided rows are moved to the front of the batch
+            size_t netRows = 0;
+            for (size_t row = 0; row < rows; row++) {
+                decisions[row] = cascade.isCalibrated() ? cascade.decide(batch.Input(row)) : ProteinFilterCascade::UNDECIDED;
+                threadDecisionCnt[decisions[row]]++;
+                if (decisions[row] == ProteinFilterCascade::UNDECIDED || checkBatch) {
+                    if (netRows != row) {
+                        std::copy(batch.Input(row), batch.Input(row) + featureCnt, batch.Input(netRows));
+                    }
+                    netRowIdx[netRows++] = row;
+                } else {
+                    accept[row] = ProteinFilterCascade::isAccept(decisions[row]);
                 }
             }
-            for (int aa = 0; aa < subMat.alphabetSize - 1; aa++) {
-                data.push_back(counter[aa] / (totalAACnt + subMat.alphabetSize - 1));
-                counter[aa] = 1.0;
-//                printf("%.4f ", data.back());
+
+            // Run prediction.
+            filter.predictRows(&batch, &quantBuffer, netRows, scores.data());
+            if (filter.isQuantized() && checkBatch) {
+                if (model.ApplyBatch(&batch, netRows) == false) {
+                    Debug(Debug::ERROR) << "Could not apply protein filter model\n";
+                    EXIT(EXIT_FAILURE);
+                }
+                for (size_t i = 0; i < netRows; i++) {
+                    const float reference = batch.Output(i)[0];
+                    threadCheckAgree += (reference > par.proteinFilterThreshold) == (scores[i] > par.proteinFilterThreshold);
+                    threadCheckMaxDiff = std::max(threadCheckMaxDiff, std::fabs(reference - scores[i]));
+                }
+                threadCheckCnt += netRows;
             }
-            // di matrix
-            {
-                rseq2mer.mapSequence(id, dbKey, seqData, seqLen);
-                float totalDiAACnt = 0;
-                while (rseq2mer.hasNextKmer()) {
-                    const unsigned char *kmer = rseq2mer.nextKmer();
-                    // ignore x
-                    if (static_cast<int>(kmer[0]) == redMat7.alphabetSize - 1 ||
-                        static_cast<int>(kmer[1]) == redMat7.alphabetSize - 1) {
-                        continue;
-                    }
-                    size_t index = indexerDi.int2index(kmer);
-                    diAACnt[index] += 1.0;
-                    totalDiAACnt += 1.0;
+            for (size_t i = 0; i < netRows; i++) {
+                const size_t row = netRowIdx[i];
+                const bool netAccept = scores[i] > par.proteinFilterThreshold;
+                if (scoreWriter != NULL) {
+                    scoreWriter->writeData(reinterpret_cast<const char *>(&scores[i]), sizeof(float), seqDb.getDbKey(batchStart + row), thread_idx);
                 }
-                size_t kmer[2];
-                float diRealRange = static_cast<float>((redMat7.alphabetSize - 1) * (redMat7.alphabetSize - 1));
-                for (int raa = 0; raa < (redMat7.alphabetSize * redMat7.alphabetSize); raa++) {
-                    indexerDi.index2int(kmer, raa, 2);
-                    if (static_cast<int>(kmer[0]) == redMat7.alphabetSize - 1 ||
-                        static_cast<int>(kmer[1]) == redMat7.alphabetSize - 1) {
-                        continue;
-                    }
-                    data.push_back(diAACnt[raa] / (totalDiAACnt + diRealRange));
-//                    printf("%.4f ", data.back());
-                    diAACnt[raa] = 1.0;
+                if (decisions[row] == ProteinFilterCascade::UNDECIDED) {
+                    accept[row] = netAccept;
+                } else {
+                    accept[row] = ProteinFilterCascade::isAccept(decisions[row]);
+                    threadCascadeCheckAgree += (netAccept == static_cast<bool>(accept[row]));
+                    threadCascadeCheckCnt++;
                 }
             }
-            // 5mer
-//            {
-//                rseq5mer.mapSequence(id, dbKey, seqData);
-//                float totalPentaAACnt = 0;
-//                while (rseq5mer.hasNextKmer()) {
-//                    const int *kmer = rseq5mer.nextKmer();
-//                    // ignore x
-//                    if (kmer[0] == redMat3.alphabetSize - 1 ||
-//                        kmer[1] == redMat3.alphabetSize - 1 ||
-//                        kmer[2] == redMat3.alphabetSize - 1 ||
-//                        kmer[3] == redMat3.alphabetSize - 1 ||
-//                        kmer[4] == redMat3.alphabetSize - 1) {
-//                        continue;
-//                    }
-//                    size_t index = indexerPenta.int2index(kmer);
-//                    pentaAACnt[index] += 1.0;
-//                    totalPentaAACnt += 1.0;
-//                }
-//                size_t kmer5[5];
-//                int pentaRealRange = static_cast<float>(MathUtil::ipow<size_t>(redMat3.alphabetSize - 1, 5));
-//                for (int raa = 0; raa < pentaIdxRange; raa++) {
-//                    indexerPenta.index2int(kmer5, raa, 5);
-//                    if (static_cast<int>(kmer5[0]) == redMat3.alphabetSize - 1 ||
-//                        static_cast<int>(kmer5[1]) == redMat3.alphabetSize - 1 ||
-//                        static_cast<int>(kmer5[2]) == redMat3.alphabetSize - 1 ||
-//                        static_cast<int>(kmer5[3]) == redMat3.alphabetSize - 1 ||
-//                        static_cast<int>(kmer5[4]) == redMat3.alphabetSize - 1) {
-//                        continue;
-//                    }
-//                    data.push_back(pentaAACnt[raa] / (totalPentaAACnt + pentaRealRange));
-//                    printf("%.4f ", data.back());
-//                    pentaAACnt[raa] = 1.0;
-//                }
-//            }
-//            printf("\n");
-            //printf("%d\n", data.size());
-            in.data_ = data;
-            // Run prediction.
-            Tensor out;
-            model.Apply(&in, &out);
-            if (out.data_[0] > par.proteinFilterThreshold) {
-                // -1 dont write \0 byte
-                dbw.writeData(seqData, seqDb.getEntryLen(id)-1, dbKey, thread_idx);
-            } else {
-                dbw.writeData("\n",  1, dbKey, thread_idx);
+
+            for (size_t id = batchStart; id < batchEnd; id++) {
+                if (accept[id - batchStart] == false) {
+                    dbw.writeData("\n",  1, seqDb.getDbKey(id), thread_idx);
+                }
             }
-//        out.Print();
         }
-
-        delete[] diAACnt;
-//        delete[] pentaAACnt;
+        delete features;
+#pragma omp critical
+        {
+            checkCnt += threadCheckCnt;
+            checkAgree += threadCheckAgree;
+            checkMaxDiff = std::max(checkMaxDiff, threadCheckMaxDiff);
+            cascadeCheckCnt += threadCascadeCheckCnt;
+            cascadeCheckAgree += threadCascadeCheckAgree;
+            for (int i = 0; i < ProteinFilterCascade::DECISION_CNT; i++) {
+                decisionCnt[i] += threadDecisionCnt[i];
+            }
+        }
+    }
+    if (par.proteinFilterQuant && checkCnt > 0) {
+        Debug(Debug::INFO) << "Quantized protein filter agrees with fp32 on " << checkAgree << " out of " << checkCnt
+                           << " sampled sequences (max. score difference " << checkMaxDiff << ")\n";
+    }
+    if (cascade.isCalibrated() && seqDb.getSize() > 0) {
+        for (int i = 0; i < ProteinFilterCascade::DECISION_CNT; i++) {
+            Debug(Debug::INFO) << "Protein filter cascade " << ProteinFilterCascade::decisionName(static_cast<ProteinFilterCascade::Decision>(i)) << ": "
+                               << decisionCnt[i] << " (" << 100.0 * decisionCnt[i] / seqDb.getSize() << "%)\n";
+        }
+        Debug(Debug::INFO) << "Protein filter cascade agrees with the network on " << cascadeCheckAgree << " out of "
+                           << cascadeCheckCnt << " sampled cascade decisions\n";
     }
 //    std::cout << "Filtered: " << static_cast<float>(cnt)/ static_cast<float>(seqDb.getSize()) << std::endl;
-    dbw.close(true);
+    if (scoreWriter != NULL) {
+        scoreWriter->close(true);
+        delete scoreWriter;
+    }
+    dbw.close();
     seqDb.close();
 
     return EXIT_SUCCESS;
 }
-
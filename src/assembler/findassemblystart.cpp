@@ -1,11 +1,15 @@
 #include "SubstitutionMatrix.h"
 #include "MultipleAlignment.h"
+#include "DistanceCalculator.h"
+#include "EvalueComputation.h"
+#include "Matcher.h"
 
 #include "DBReader.h"
 #include "DBWriter.h"
 #include "Debug.h"
 #include "Util.h"
 #include "LocalParameters.h"
+#include "OverlayDBWriter.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -24,6 +28,89 @@ int findPosOfM(const char *seq) {
     return stopPos;
 }
 
+// sequence after findassemblystart: * and the suffix starting at the consensus M
+static void correctedSequence(DBReader<unsigned int> &seqDbr, size_t id, int mPos, unsigned int thread_idx, std::string &seq) {
+    const char *data = seqDbr.getData(id, thread_idx);
+    const size_t seqLen = seqDbr.getSeqLen(id);
+    seq.clear();
+    if (mPos == -1) {
+        seq.append(data, seqLen);
+    } else {
+        seq.push_back('*');
+        seq.append(data + mPos, seqLen - mPos);
+    }
+}
+
+// Translates an ungapped alignment of the input sequences to the corrected sequences. Residues
+// keep their alignment partners, positions in a trimmed prefix are gone and the new * is
+// aligned to whatever lies on the diagonal. Only if the overlap of the diagonal changed, the
+// alignment is recomputed. Identity, coverage and E-value depend on the new lengths, so every
+// shifted alignment has to pass the rescorediagonal thresholds again.
+static bool shiftAlignment(Matcher::result_t &res, int qMPos, int tMPos, const std::string &qSeq, const std::string &tSeq,
+                           const SubstitutionMatrix::FastMatrix &fastMatrix, EvalueComputation &evaluer, const LocalParameters &par) {
+    // corrected position = position - shift
+    const int qShift = (qMPos == -1) ? 0 : qMPos - 1;
+    const int tShift = (tMPos == -1) ? 0 : tMPos - 1;
+    const int qLen = static_cast<int>(qSeq.size());
+    const int tLen = static_cast<int>(tSeq.size());
+    const int diag = (res.qStartPos - qShift) - (res.dbStartPos - tShift);
+    const int qStart = std::max(diag, 0);
+    const int tStart = std::max(-diag, 0);
+    const int overlapLen = std::min(qLen - qStart, tLen - tStart);
+    if (overlapLen <= 0) {
+        // the alignment was completely in a trimmed prefix
+        return false;
+    }
+
+    // a global diagonal alignment that covers the same residues keeps its score
+    const bool sameOverlap = par.rescoreMode == Parameters::RESCORE_MODE_GLOBAL_ALIGNMENT
+                             && res.qStartPos - qShift == qStart && res.qEndPos - qShift == qStart + overlapLen - 1
+                             && (qMPos == -1 || qStart > 0) && (tMPos == -1 || tStart > 0);
+    double rawScore;
+    if (sameOverlap == false) {
+        DistanceCalculator::LocalAlignment alignment = DistanceCalculator::ungappedAlignmentByDiagonal(
+                qSeq.c_str(), qLen, tSeq.c_str(), tLen, diag, fastMatrix.matrix, par.rescoreMode);
+        const int dist = std::abs(alignment.diagonal);
+        res.qStartPos = alignment.startPos + ((alignment.diagonal >= 0) ? dist : 0);
+        res.qEndPos = alignment.endPos + ((alignment.diagonal >= 0) ? dist : 0);
+        res.dbStartPos = alignment.startPos + ((alignment.diagonal >= 0) ? 0 : dist);
+        res.dbEndPos = alignment.endPos + ((alignment.diagonal >= 0) ? 0 : dist);
+        res.alnLength = res.qEndPos - res.qStartPos + 1;
+        rawScore = alignment.score;
+        res.score = static_cast<int>(evaluer.computeBitScore(rawScore) + 0.5);
+    } else {
+        res.qStartPos -= qShift;
+        res.qEndPos -= qShift;
+        res.dbStartPos -= tShift;
+        res.dbEndPos -= tShift;
+        rawScore = evaluer.computeRawScoreFromBitScore(res.score);
+    }
+    res.qLen = qLen;
+    res.dbLen = tLen;
+    res.eval = evaluer.computeEvalue(rawScore, qLen);
+
+    int idCnt = 0;
+    for (int i = 0; i < static_cast<int>(res.alnLength); i++) {
+        idCnt += (qSeq[res.qStartPos + i] == tSeq[res.dbStartPos + i]) ? 1 : 0;
+    }
+    res.seqId = Util::computeSeqId(par.seqIdMode, idCnt, qLen, tLen, res.alnLength);
+    res.qcov = Matcher::computeCov(res.qStartPos, res.qEndPos, res.qLen);
+    res.dbcov = Matcher::computeCov(res.dbStartPos, res.dbEndPos, res.dbLen);
+    if (res.seqId < par.seqIdThr || res.eval > par.evalThr || static_cast<int>(res.alnLength) < par.alnLenThr
+        || Util::hasCoverage(par.covThr, par.covMode, res.qcov, res.dbcov) == false) {
+        return false;
+    }
+    if (par.includeOnlyExtendable) {
+        const bool extendsLeft = res.qStartPos == 0 && res.dbEndPos == tLen - 1;
+        const bool extendsRight = res.dbStartPos == 0 && res.qEndPos == qLen - 1;
+        if (extendsLeft == false && extendsRight == false) {
+            return false;
+        }
+    }
+    res.backtrace = SSTR(res.alnLength) + "M";
+    return true;
+}
+
 int findassemblystart(int argn, const char **argv, const Command& command) {
     LocalParameters& par = LocalParameters::getLocalInstance();
     par.parseParameters(argn, argv, command, true, 0, 0);
@@ -36,7 +123,9 @@ int findassemblystart(int argn, const char **argv, const Command& command) {
     DBReader<unsigned int> resultReader(par.db2.c_str(), par.db2Index.c_str(), par.threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
     resultReader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
 
-    DBWriter resultWriter(par.db3.c_str(), par.db3Index.c_str(), par.threads, par.compressed, Parameters::DBTYPE_AMINO_ACIDS);
+    // only sequences with a new start are written, all others are taken from the input
+    OverlayDBWriter::checkCompression(par.PARAM_COMPRESSED.wasSet, par.compressed, qDbr);
+    OverlayDBWriter resultWriter(qDbr, par.db3.c_str(), par.db3Index.c_str(), par.threads, Parameters::DBTYPE_AMINO_ACIDS);
     resultWriter.open();
 
     // + 1 for query
@@ -155,18 +244,82 @@ int findassemblystart(int argn, const char **argv, const Command& command) {
 
 #pragma omp for schedule(dynamic, 100)
         for(size_t id = 0; id < qDbr.getSize(); id++){
-            unsigned int queryKey = qDbr.getDbKey(id);
-            char *querySeqData = tDbr->getData(id, thread_idx);
             int mPos = addStopAtPosition[id];
             if (mPos == -1){
-                resultWriter.writeData(querySeqData, strlen(querySeqData), queryKey, thread_idx);
-            } else {
-                str.append("*");
-                str.append(querySeqData + mPos);
-                resultWriter.writeData(str.c_str(), str.length(), queryKey, thread_idx);
-                str.clear();
+                continue;
+            }
+            unsigned int queryKey = qDbr.getDbKey(id);
+            char *querySeqData = tDbr->getData(id, thread_idx);
+            str.append("*");
+            str.append(querySeqData + mPos);
+            resultWriter.writeData(str.c_str(), str.length(), queryKey, thread_idx);
+            str.clear();
+        }
+    }
+
+    // the alignments of the corrected sequences are derived from the input alignments instead of a new
+    // prefilter and alignment, only entries of the result DB are written
+    if (par.filenames.size() > 3) {
+        DBWriter alnWriter(par.db4.c_str(), par.db4Index.c_str(), par.threads, par.compressed, Parameters::DBTYPE_ALIGNMENT_RES);
+        alnWriter.open();
+        SubstitutionMatrix::FastMatrix fastMatrix = SubstitutionMatrix::createAsciiSubMat(subMat);
+        EvalueComputation evaluer(qDbr.getAminoAcidDBSize(), &subMat);
+        size_t shiftedCnt = 0;
+        size_t droppedCnt = 0;
+
+#pragma omp parallel reduction(+:shiftedCnt, droppedCnt)
+        {
+            unsigned int thread_idx = 0;
+#ifdef OPENMP
+            thread_idx = (unsigned int) omp_get_thread_num();
+#endif
+            char buffer[1024 + 32768];
+            std::string qSeq;
+            std::string tSeq;
+
+#pragma omp for schedule(dynamic, 100)
+            for (size_t id = 0; id < resultReader.getSize(); id++) {
+                const unsigned int queryKey = resultReader.getDbKey(id);
+                const size_t qId = qDbr.getId(queryKey);
+                const int qMPos = addStopAtPosition[qId];
+                bool hasQuerySeq = false;
+
+                alnWriter.writeStart(thread_idx);
+                char *results = resultReader.getData(id, thread_idx);
+                while (*results != '\0') {
+                    char *nextLine = Util::skipLine(results);
+                    char dbKey[255 + 1];
+                    Util::parseKey(results, dbKey);
+                    const unsigned int key = (unsigned int) strtoul(dbKey, NULL, 10);
+                    const size_t tId = qDbr.getId(key);
+                    const int tMPos = addStopAtPosition[tId];
+                    if (qMPos == -1 && tMPos == -1) {
+                        alnWriter.writeAdd(results, nextLine - results, thread_idx);
+                        results = nextLine;
+                        continue;
+                    }
+                    if (hasQuerySeq == false) {
+                        correctedSequence(qDbr, qId, qMPos, thread_idx, qSeq);
+                        hasQuerySeq = true;
+                    }
+                    correctedSequence(qDbr, tId, tMPos, thread_idx, tSeq);
+                    const char *entry[255];
+                    const bool hasBacktrace = Util::getWordsOfLine(results, entry, 255) >= Matcher::ALN_RES_WITH_BT_COL_CNT;
+                    Matcher::result_t res = Matcher::parseAlignmentRecord(results);
+                    if (shiftAlignment(res, qMPos, tMPos, qSeq, tSeq, fastMatrix, evaluer, par)) {
+                        size_t len = Matcher::resultToBuffer(buffer, res, hasBacktrace, false);
+                        alnWriter.writeAdd(buffer, len, thread_idx);
+                        shiftedCnt++;
+                    } else {
+                        droppedCnt++;
+                    }
+                    results = nextLine;
+                }
+                alnWriter.writeEnd(queryKey, thread_idx);
             }
         }
+        alnWriter.close();
+        Debug(Debug::INFO) << "Shifted " << shiftedCnt << " and dropped " << droppedCnt << " alignments of corrected sequences\n";
     }
 
     // cleanup
@@ -1,6 +1,7 @@
 
 #include "NucleotideMatrix.h"
 #include "LocalParameters.h"
+#include "AssemblyStats.h"
 #include "DistanceCalculator.h"
 #include "Matcher.h"
 #include "DBReader.h"
@@ -81,6 +82,10 @@ int dohybridassembleresult(LocalParameters &par) {
 
     unsigned char * wasExtended = new unsigned char[nuclSequenceDbr->getSize()];
     std::fill(wasExtended, wasExtended+nuclSequenceDbr->getSize(), 0);
+    size_t extendedCnt = 0;
+    size_t inputResidues = 0;
+    size_t addedResidues = 0;
+    size_t writtenCnt = 0;
     Debug::Progress progress(nuclSequenceDbr->getSize());
 #pragma omp parallel
     {
@@ -91,7 +96,7 @@ int dohybridassembleresult(LocalParameters &par) {
         std::vector<Matcher::result_t> nuclAlignments;
         nuclAlignments.reserve(300);
 
-        #pragma omp for schedule(dynamic, 100)
+        #pragma omp for schedule(dynamic, 100) reduction(+:extendedCnt, inputResidues, addedResidues, writtenCnt)
         for (size_t id = 0; id < nuclSequenceDbr->getSize(); id++) {
             progress.updateProgress();
             unsigned int queryKey = nuclSequenceDbr->getDbKey(id);
@@ -106,6 +111,7 @@ int dohybridassembleresult(LocalParameters &par) {
             unsigned int nuclLeftQueryOffset = 0;
             unsigned int nuclRightQueryOffset = 0;
             std::string nuclQuery(nuclQuerySeq, nuclQuerySeqLen); // no /n/0
+            inputResidues += nuclQuerySeqLen;
             std::string aaQuery(aaQuerySeq, aaQuerySeqLen); // no /n/0
 
             bool excludeLeftExtension = (aaQuery[0] == '*');
@@ -165,9 +171,14 @@ int dohybridassembleresult(LocalParameters &par) {
                             continue;
                         }
                     }
-                    __sync_or_and_fetch(&wasExtended[nuclTargetId], static_cast<unsigned char>(0x10));
                     int qStartPos, qEndPos, nuclDbStartPos, nuclDbEndPos;
                     int diagonal = (nuclLeftQueryOffset + nuclBesttHitToExtend.qStartPos) - nuclBesttHitToExtend.dbStartPos;
+                    // the amino acid fragment is cut at nuclDbStartPos/3 and nuclDbEndPos/3, an off frame
+                    // diagonal would append a protein that does not match the appended nucleotides
+                    if (diagonal % 3 != 0) {
+                        continue;
+                    }
+                    __sync_or_and_fetch(&wasExtended[nuclTargetId], static_cast<unsigned char>(0x10));
                     int dist = std::max(abs(diagonal), 0);
                     DistanceCalculator::LocalAlignment alignment = DistanceCalculator::ungappedAlignmentByDiagonal(
                             nuclQuerySeq, nuclQuerySeqLen,
@@ -269,6 +280,9 @@ int dohybridassembleresult(LocalParameters &par) {
                 }
             }
             if (queryCouldBeExtended == true) {
+                extendedCnt++;
+                addedResidues += nuclQuery.size() - nuclSequenceDbr->getSeqLen(id);
+                writtenCnt++;
                 nuclQuery.push_back('\n');
                 aaQuery.push_back('\n');
                 __sync_or_and_fetch(&wasExtended[id], static_cast<unsigned char>(0x20));
@@ -279,7 +293,7 @@ int dohybridassembleresult(LocalParameters &par) {
     } // end parallel
 
 // add sequences that are not yet assembled
-#pragma omp parallel for schedule(dynamic, 10000)
+#pragma omp parallel for schedule(dynamic, 10000) reduction(+:writtenCnt)
     for (size_t id = 0; id < nuclSequenceDbr->getSize(); id++) {
         unsigned int thread_idx = 0;
 #ifdef OPENMP
@@ -298,12 +312,42 @@ int dohybridassembleresult(LocalParameters &par) {
             char *queryAASeqData = aaSequenceDbr->getData(id, thread_idx);
             unsigned int queryAALen = aaSequenceDbr->getEntryLen(id) - 1; //skip null byte
             aaResultWriter.writeData(queryAASeqData, queryAALen, aaSequenceDbr->getDbKey(id), thread_idx);
+            writtenCnt++;
+        }
+    }
+
+    // keys of ORFs that ended up in a contig, either as contig or as extending fragment
+    if (par.skipAbsorbedReads) {
+        std::string absorbedData = par.db4 + "_absorbed";
+        std::string absorbedIndex = par.db4 + "_absorbed.index";
+        DBWriter absorbedWriter(absorbedData.c_str(), absorbedIndex.c_str(), par.threads, false, Parameters::DBTYPE_GENERIC_DB);
+        absorbedWriter.open();
+#pragma omp parallel for schedule(static)
+        for (size_t id = 0; id < nuclSequenceDbr->getSize(); id++) {
+            unsigned int thread_idx = 0;
+#ifdef OPENMP
+            thread_idx = (unsigned int) omp_get_thread_num();
+#endif
+            if (wasExtended[id] & (0x20 | 0x80)) {
+                absorbedWriter.writeData("", 0, nuclSequenceDbr->getDbKey(id), thread_idx);
+            }
         }
+        absorbedWriter.close();
     }
 
     // cleanup
     aaResultWriter.close(aaSequenceDbr->getDbtype());
     nuclResultWriter.close(nuclSequenceDbr->getDbtype());
+
+    // residues are counted on the nucleotide contigs
+    AssemblyStats stats;
+    stats.queries = nuclSequenceDbr->getSize();
+    stats.extended = extendedCnt;
+    stats.inputResidues = inputResidues;
+    stats.addedResidues = addedResidues;
+    stats.written = writtenCnt;
+    stats.write(par.db4, par.convergeThreshold);
+
     nuclAlnReader->close();
     delete [] wasExtended;
     delete nuclAlnReader;
@@ -1,5 +1,6 @@
-#include <flash/combine_reads.h>
 #include "KSeqWrapper.h"
+#include "ParallelGzipReader.h"
+#include "ReadPairMerger.h"
 #include "SubstitutionMatrix.h"
 #include "MultipleAlignment.h"
 #include "DBReader.h"
@@ -7,11 +8,62 @@
 #include "Debug.h"
 #include "Util.h"
 #include "LocalParameters.h"
+#include "OverlayDBWriter.h"
+#include "FileUtil.h"
+
+#include <algorithm>
+#include <cstdio>
 
 #ifdef OPENMP
 #include <omp.h>
 #endif
 
+static void writeEntry(DBWriter &writer, const std::string &data, unsigned int key, unsigned int thread_idx) {
+    char newLine = '\n';
+    writer.writeStart(thread_idx);
+    writer.writeAdd(data.c_str(), data.size(), thread_idx);
+    writer.writeAdd(&newLine, 1, thread_idx);
+    writer.writeEnd(key, thread_idx, true);
+}
+
+// Moves the data file of each lane DB to <outDb>.<lane>, so that they form the data files of a
+// multi-file DB, and writes its index. The keys of each lane follow the keys of the previous lanes.
+static void concatLanes(const std::string &outDb, const std::vector<std::string> &laneDbs) {
+    OverlayDBWriter::removeDatafiles(outDb);
+    std::string outIndex = outDb + ".index";
+    FILE *out = fopen(outIndex.c_str(), "w");
+    if (out == NULL) {
+        Debug(Debug::ERROR) << "Could not write " << outIndex << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    size_t dataOffset = 0;
+    unsigned int keyOffset = 0;
+    for (size_t lane = 0; lane < laneDbs.size(); lane++) {
+        std::string laneIndex = laneDbs[lane] + ".index";
+        DBReader<unsigned int> reader(laneDbs[lane].c_str(), laneIndex.c_str(), 1, DBReader<unsigned int>::USE_INDEX);
+        reader.open(DBReader<unsigned int>::NOSORT);
+        for (size_t id = 0; id < reader.getSize(); id++) {
+            fprintf(out, "%u\t%zu\t%zu\n", keyOffset + reader.getDbKey(id), dataOffset + reader.getOffset(id), reader.getEntryLen(id));
+        }
+        keyOffset += reader.getSize();
+        reader.close();
+
+        std::string laneData = outDb + "." + SSTR(lane);
+        dataOffset += FileUtil::getFileSize(laneDbs[lane]);
+        FileUtil::move(laneDbs[lane].c_str(), laneData.c_str());
+        FileUtil::remove(laneIndex.c_str());
+    }
+    if (fclose(out) != 0) {
+        Debug(Debug::ERROR) << "Could not write " << outIndex << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    // all lanes have the same dbtype, the dbtype file is moved last, it marks the DB as complete
+    for (size_t lane = 1; lane < laneDbs.size(); lane++) {
+        FileUtil::remove((laneDbs[lane] + ".dbtype").c_str());
+    }
+    FileUtil::move((laneDbs[0] + ".dbtype").c_str(), (outDb + ".dbtype").c_str());
+}
+
 int mergereads(int argn, const char **argv, const Command& command) {
     LocalParameters& par = LocalParameters::getLocalInstance();
     par.parseParameters(argn, argv, command, true, Parameters::PARSE_VARIADIC, 0);
@@ -20,103 +72,145 @@ int mergereads(int argn, const char **argv, const Command& command) {
     Debug(Debug::INFO) << "Start merging reads.\n";
 
     //TODO: check inputfiles exists
-    //TODO
-    combine_params alg_params;
-    alg_params.max_overlap = 65;
-    alg_params.min_overlap = 15;
-    alg_params.max_mismatch_density = 0.10;
-    alg_params.cap_mismatch_quals = false;
-    alg_params.allow_outies = false;
+    ReadPairMerger merger;
 
     std::vector<std::string> filenames(par.filenames);
     std::string outFile = par.filenames.back();
-    std::string outIndexFile = outFile + ".index";
-    DBWriter resultWriter(outFile.c_str(), outIndexFile.c_str(), 1, par.compressed, Parameters::DBTYPE_NUCLEOTIDES);
-    resultWriter.open();
-    DBWriter headerResultWriter((outFile+"_h").c_str(), (outFile+"_h.index").c_str(), 1, par.compressed, Parameters::DBTYPE_GENERIC_DB);
-    headerResultWriter.open();
-    unsigned int id = 0;
+    const size_t laneCnt = filenames.size() / 2;
+    if (laneCnt == 0) {
+        Debug(Debug::ERROR) << "mergereads needs at least one pair of read files\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    // Lanes (pairs of files) are merged concurrently, each into its own DB with keys starting at 0.
+    // The lane DBs are joined in lane order at the end, so every read gets the key it would get if
+    // the lanes were processed one after the other. Within a lane, reading the next batch of both
+    // mates, merging the current batch in chunk tasks and writing the previous batch overlap.
+    const size_t batchSize = 16384;
+    const size_t chunkSize = 512;
+    // half of the threads inflate BGZF input of the two mates of all running lanes, the other half merges
+    const size_t concurrentLanes = std::min(laneCnt, static_cast<size_t>(std::max(1, par.threads / 4)));
+    const int inflateThreads = std::max(1, par.threads / static_cast<int>(4 * concurrentLanes));
+    const int mergeThreads = std::max(static_cast<int>(concurrentLanes), par.threads - static_cast<int>(2 * concurrentLanes) * inflateThreads);
+
+    std::vector<std::string> laneDbs;
+    std::vector<std::string> laneHeaderDbs;
+    std::vector<DBWriter *> laneWriters;
+    std::vector<DBWriter *> laneHeaderWriters;
+    for (size_t lane = 0; lane < laneCnt; lane++) {
+        laneDbs.push_back(outFile + "_lane" + SSTR(lane));
+        laneHeaderDbs.push_back(outFile + "_h_lane" + SSTR(lane));
+        laneWriters.push_back(new DBWriter(laneDbs[lane].c_str(), (laneDbs[lane] + ".index").c_str(), mergeThreads, par.compressed, Parameters::DBTYPE_NUCLEOTIDES));
+        laneWriters[lane]->open();
+        laneHeaderWriters.push_back(new DBWriter(laneHeaderDbs[lane].c_str(), (laneHeaderDbs[lane] + ".index").c_str(), mergeThreads, par.compressed, Parameters::DBTYPE_GENERIC_DB));
+        laneHeaderWriters[lane]->open();
+    }
+
+    size_t nextLane = 0;
+#pragma omp parallel num_threads(mergeThreads)
     {
-        struct read* r1 = (struct read*) calloc(1, sizeof(struct read));
-        struct read* r2 = (struct read*) calloc(1, sizeof(struct read));
-        struct read* r_combined = (struct read*) calloc(1, sizeof(struct read));
-
-        for (size_t i = 0; i < filenames.size() / 2; i++) {
-            std::string splitHeader;
-            splitHeader.reserve(1024);
-            std::string header;
-            header.reserve(1024);
-            std::string splitId;
-            splitId.reserve(1024);
-            KSeqWrapper *kseq1 = KSeqFactory(filenames[i * 2].c_str());
-            KSeqWrapper *kseq2 = KSeqFactory(filenames[i * 2 + 1].c_str());
-            while (kseq1->ReadEntry() && kseq2->ReadEntry()) {
-                const KSeqWrapper::KSeqEntry &read1 = kseq1->entry;
-                const KSeqWrapper::KSeqEntry &read2 = kseq2->entry;
-
-
-                r1->seq =  read1.sequence.s;
-                r1->seq_len = read1.sequence.l;
-                r1->qual = read1.qual.s;
-                r1->qual_len = read1.qual.l;
-
-                r2->seq = read2.sequence.s;
-                r2->seq_len = read2.sequence.l;
-                r2->qual = read2.qual.s;
-                r2->qual_len = read2.qual.l;
-                reverse_complement(r2);
-                enum combine_status status = combine_reads(r1, r2, r_combined, &alg_params);
-                char newLine = '\n';
-                switch (status) {
-                    case COMBINED_AS_INNIE:
-                    case COMBINED_AS_OUTIE:
-                        //resultWriter.writeData(r_combined->seq, r_combined->seq_len,  id);
-                        resultWriter.writeStart(0);
-                        resultWriter.writeAdd(r_combined->seq, r_combined->seq_len, 0);
-                        resultWriter.writeAdd(&newLine, 1, 0);
-                        resultWriter.writeEnd(id, 0, true);
-                        headerResultWriter.writeStart(0);
-                        headerResultWriter.writeAdd(read1.name.s, read1.name.l, 0);
-                        headerResultWriter.writeAdd(&newLine, 1, 0);
-                        headerResultWriter.writeEnd(id, 0, true);
+#pragma omp single
+        for (size_t worker = 0; worker < concurrentLanes; worker++) {
+#pragma omp task shared(nextLane, laneWriters, laneHeaderWriters, merger, filenames)
+            while (true) {
+                size_t lane;
+#pragma omp atomic capture
+                lane = nextLane++;
+                if (lane >= laneCnt) {
+                    break;
+                }
+                DBWriter &resultWriter = *laneWriters[lane];
+                DBWriter &headerResultWriter = *laneHeaderWriters[lane];
+                KSeqWrapper *kseq1 = ParallelKSeqFactory(filenames[lane * 2].c_str(), inflateThreads);
+                KSeqWrapper *kseq2 = ParallelKSeqFactory(filenames[lane * 2 + 1].c_str(), inflateThreads);
+                // buffers of the batch being read, merged and written
+                std::vector<ReadEntry> mates1[3];
+                std::vector<ReadEntry> mates2[3];
+                std::vector<MergedPair> merged[3];
+                for (size_t i = 0; i < 3; i++) {
+                    merged[i].resize(batchSize);
+                }
+                size_t cnt1 = readBatch(kseq1, mates1[0], batchSize);
+                size_t cnt2 = readBatch(kseq2, mates2[0], batchSize);
+                size_t cur = 0;
+                unsigned int key = 0;
+                while (cnt1 > 0 && cnt2 > 0) {
+                    const size_t pairCnt = std::min(cnt1, cnt2);
+                    const bool lastBatch = (cnt1 != cnt2 || cnt1 < batchSize);
+                    const size_t next = (cur + 1) % 3;
+                    size_t nextCnt1 = 0;
+                    size_t nextCnt2 = 0;
+                    if (lastBatch == false) {
+#pragma omp task shared(nextCnt1, mates1) firstprivate(next)
+                        nextCnt1 = readBatch(kseq1, mates1[next], batchSize);
+#pragma omp task shared(nextCnt2, mates2) firstprivate(next)
+                        nextCnt2 = readBatch(kseq2, mates2[next], batchSize);
+                    }
+                    for (size_t start = 0; start < pairCnt; start += chunkSize) {
+#pragma omp task shared(mates1, mates2, merged, merger) firstprivate(start, cur)
+                        merger.merge(mates1[cur], mates2[cur], merged[cur], start, std::min(start + chunkSize, pairCnt));
+                    }
+#pragma omp taskwait
 
+                    // the batch is written while the next one is read and merged, its keys follow the previous batch
+                    const unsigned int batchKey = key;
+                    for (size_t i = 0; i < pairCnt; i++) {
+                        key += (merged[cur][i].status == NOT_COMBINED) ? 2 : 1;
+                    }
+#pragma omp task shared(mates1, mates2, merged, resultWriter, headerResultWriter) firstprivate(cur, pairCnt, batchKey)
+                    {
+                        unsigned int thread_idx = 0;
+#ifdef OPENMP
+                        thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+                        unsigned int writeKey = batchKey;
+                        for (size_t i = 0; i < pairCnt; i++) {
+                            switch (merged[cur][i].status) {
+                                case COMBINED_AS_INNIE:
+                                case COMBINED_AS_OUTIE:
+                                    writeEntry(resultWriter, merged[cur][i].seq, writeKey, thread_idx);
+                                    writeEntry(headerResultWriter, mates1[cur][i].name, writeKey, thread_idx);
+                                    break;
+                                case NOT_COMBINED:
+                                    writeEntry(resultWriter, mates1[cur][i].seq, writeKey, thread_idx);
+                                    writeEntry(headerResultWriter, mates1[cur][i].name, writeKey, thread_idx);
+                                    writeKey++;
+                                    writeEntry(resultWriter, mates2[cur][i].seq, writeKey, thread_idx);
+                                    writeEntry(headerResultWriter, mates2[cur][i].name, writeKey, thread_idx);
+                                    break;
+                            }
+                            writeKey++;
+                        }
+                    }
+
+                    if (lastBatch) {
                         break;
-                    case NOT_COMBINED:
-                        resultWriter.writeStart(0);
-                        resultWriter.writeAdd(r1->seq, r1->seq_len, 0);
-                        resultWriter.writeAdd(&newLine, 1, 0);
-                        resultWriter.writeEnd(id, 0, true);
-                        headerResultWriter.writeStart(0);
-                        headerResultWriter.writeAdd(read1.name.s, read1.name.l, 0);
-                        headerResultWriter.writeAdd(&newLine, 1, 0);
-                        headerResultWriter.writeEnd(id, 0, true);
-                        id++;
-                        resultWriter.writeStart(0);
-                        resultWriter.writeAdd(r2->seq, r2->seq_len, 0);
-                        resultWriter.writeAdd(&newLine, 1, 0);
-                        resultWriter.writeEnd(id, 0, true);
-                        headerResultWriter.writeStart(0);
-                        headerResultWriter.writeAdd(read2.name.s, read2.name.l, 0);
-                        headerResultWriter.writeAdd(&newLine, 1, 0);
-                        headerResultWriter.writeEnd(id, 0, true);
-                        break;
+                    }
+                    cnt1 = nextCnt1;
+                    cnt2 = nextCnt2;
+                    cur = next;
+                }
+#pragma omp taskwait
+                // reads behind the end of the shorter file are not written
+                if (cnt1 != cnt2) {
+                    Debug(Debug::WARNING) << "Number of reads in " << filenames[lane * 2] << " and " << filenames[lane * 2 + 1] << " differs\n";
                 }
-                id++;
+                delete kseq1;
+                delete kseq2;
             }
-            delete kseq1;
-            delete kseq2;
         }
-        free(r_combined);
-        free(r2);
-        free(r1);
     }
-    resultWriter.close(true);
-    headerResultWriter.close(true);
+
+    for (size_t lane = 0; lane < laneCnt; lane++) {
+        laneWriters[lane]->close(true);
+        delete laneWriters[lane];
+        laneHeaderWriters[lane]->close(true);
+        delete laneHeaderWriters[lane];
+    }
+    concatLanes(outFile, laneDbs);
+    concatLanes(outFile + "_h", laneHeaderDbs);
 
     Debug(Debug::INFO) << "\nDone.\n";
 
     return EXIT_SUCCESS;
 }
-
-
-
@@ -0,0 +1,241 @@
+#include "KSeqWrapper.h"
+#include "ParallelGzipReader.h"
+#include "ReadPairMerger.h"
+#include "DBWriter.h"
+#include "Debug.h"
+#include "Util.h"
+#include "Orf.h"
+#include "TranslateNucl.h"
+#include "LocalParameters.h"
+
+#include <climits>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+// one extractorfs configuration of the assembledb workflow
+struct OrfSettings {
+    size_t minLength;
+    size_t maxLength;
+    size_t maxGaps;
+    unsigned int startMode;
+    int contigStartMode;
+    int contigEndMode;
+};
+
+// translated ORFs of one read (or merged read pair)
+struct ReadOrfs {
+    std::string headers;
+    std::vector<size_t> headerEnds;
+    std::string proteins;
+    std::vector<size_t> proteinEnds;
+
+    void clear() {
+        headers.clear();
+        headerEnds.clear();
+        proteins.clear();
+        proteinEnds.clear();
+    }
+};
+
+static void extractOrfs(Orf &orf, const TranslateNucl &translateNucl, const std::string &seq, unsigned int readKey,
+                        const OrfSettings &settings, unsigned int forwardFrames, unsigned int reverseFrames, bool addOrfStop,
+                        std::vector<Orf::SequenceLocation> &locations, std::string &aa, ReadOrfs &out) {
+    locations.clear();
+    orf.findAll(locations, settings.minLength, settings.maxLength, settings.maxGaps, forwardFrames, reverseFrames, settings.startMode);
+    char buffer[LINE_MAX];
+    for (size_t i = 0; i < locations.size(); i++) {
+        const Orf::SequenceLocation &loc = locations[i];
+        if (settings.contigStartMode < 2 && (loc.hasIncompleteStart == settings.contigStartMode)) {
+            continue;
+        }
+        if (settings.contigEndMode < 2 && (loc.hasIncompleteEnd == settings.contigEndMode)) {
+            continue;
+        }
+        std::pair<const char *, size_t> nucl = orf.view(loc);
+        size_t length = nucl.second;
+        if (length < 3) {
+            continue;
+        }
+        length -= length % 3;
+        // same translation as translatenucs
+        aa.resize(length / 3 + 2);
+        translateNucl.translate(&aa[0], nucl.first, length);
+        size_t aaLength = length / 3;
+        if (addOrfStop && loc.hasIncompleteEnd == false && aa[aaLength - 1] != '*') {
+            aa[aaLength] = '*';
+            aaLength++;
+        }
+        out.proteins.append(aa.data(), aaLength);
+        out.proteins.push_back('\n');
+        out.proteinEnds.push_back(out.proteins.size());
+
+        size_t fromPos = loc.from;
+        size_t toPos = loc.to;
+        if (loc.strand == Orf::STRAND_MINUS) {
+            fromPos = (seq.size() - 1) - loc.from;
+            toPos = (seq.size() - 1) - loc.to;
+        }
+        size_t headerLen = Orf::writeOrfHeader(buffer, readKey, fromPos, toPos, loc.hasIncompleteStart, loc.hasIncompleteEnd);
+        out.headers.append(buffer, headerLen);
+        out.headerEnds.push_back(out.headers.size());
+    }
+}
+
+// Streaming front end of the assembledb workflow: reads FASTA/FASTQ files, merges read pairs and
+// writes the translated "long" and "start" ORF sets of every read, the same entries as
+// extractorfs, translatenucs and concatdbs produce from the nucl_reads DB, without writing
+// any intermediate DB. ORF headers refer to the read keys mergereads or createdb would assign.
+int readorfs(int argn, const char **argv, const Command& command) {
+    LocalParameters& par = LocalParameters::getLocalInstance();
+    par.parseParameters(argn, argv, command, true, Parameters::PARSE_VARIADIC, 0);
+
+    std::vector<std::string> filenames(par.filenames);
+    std::string outFile = filenames.back();
+    filenames.pop_back();
+    if (par.pairedEnd && filenames.size() % 2 != 0) {
+        Debug(Debug::ERROR) << "Paired-end input needs an even number of read files\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    // same settings as the EXTRACTORFS_LONG_PAR and EXTRACTORFS_START_PAR of assembledb
+    OrfSettings orfSettings[2];
+    orfSettings[0].minLength = par.orfMinLength;
+    orfSettings[0].maxLength = par.orfMaxLength;
+    orfSettings[0].maxGaps = 0;
+    orfSettings[0].startMode = 0;
+    orfSettings[0].contigStartMode = par.contigStartMode;
+    orfSettings[0].contigEndMode = par.contigEndMode;
+    orfSettings[1].minLength = std::min(par.orfMinLength, 20);
+    orfSettings[1].maxLength = par.orfMinLength;
+    orfSettings[1].maxGaps = 0;
+    orfSettings[1].startMode = 0;
+    orfSettings[1].contigStartMode = 1;
+    orfSettings[1].contigEndMode = 0;
+    const unsigned int forwardFrames = Orf::getFrames(par.forwardFrames);
+    const unsigned int reverseFrames = Orf::getFrames(par.reverseFrames);
+    const bool addOrfStop = par.addOrfStop;
+
+    DBWriter sequenceWriter(outFile.c_str(), (outFile + ".index").c_str(), par.threads, par.compressed, Parameters::DBTYPE_AMINO_ACIDS);
+    sequenceWriter.open();
+    DBWriter headerWriter((outFile + "_h").c_str(), (outFile + "_h.index").c_str(), par.threads, par.compressed, Parameters::DBTYPE_GENERIC_DB);
+    headerWriter.open();
+
+    ReadPairMerger merger;
+    const size_t batchSize = 65536;
+    const size_t fileCnt = par.pairedEnd ? 2 : 1;
+    // half of the threads inflate BGZF input of the mates, the other half merges and extracts ORFs
+    const int inflateThreads = std::max(1, par.threads / static_cast<int>(2 * fileCnt));
+    const int workThreads = std::max(1, par.threads - static_cast<int>(fileCnt) * inflateThreads);
+    std::vector<ReadEntry> mates1;
+    std::vector<ReadEntry> mates2;
+    std::vector<MergedPair> merged(batchSize);
+    // merged pairs give one sequence, others two, as in mergereads
+    std::vector<const std::string *> reads;
+    std::vector<ReadOrfs> readOrfs;
+    std::vector<unsigned int> orfOffsets;
+    unsigned int readKey = 0;
+    unsigned int orfKey = 0;
+    size_t readCnt = 0;
+    for (size_t lane = 0; lane < filenames.size(); lane += fileCnt) {
+        KSeqWrapper *kseq1 = ParallelKSeqFactory(filenames[lane].c_str(), inflateThreads);
+        KSeqWrapper *kseq2 = par.pairedEnd ? ParallelKSeqFactory(filenames[lane + 1].c_str(), inflateThreads) : NULL;
+        while (true) {
+            size_t cnt = readBatch(kseq1, mates1, batchSize);
+            if (kseq2 != NULL) {
+                size_t cnt2 = readBatch(kseq2, mates2, batchSize);
+                if (cnt != cnt2) {
+                    Debug(Debug::WARNING) << "Number of reads in " << filenames[lane] << " and " << filenames[lane + 1] << " differs\n";
+                    cnt = std::min(cnt, cnt2);
+                }
+            }
+            if (cnt == 0) {
+                break;
+            }
+            readCnt += cnt;
+
+            if (kseq2 != NULL) {
+#pragma omp parallel for schedule(dynamic, 1) num_threads(workThreads)
+                for (size_t start = 0; start < cnt; start += 512) {
+                    merger.merge(mates1, mates2, merged, start, std::min(start + 512, cnt));
+                }
+            }
+            reads.clear();
+            for (size_t i = 0; i < cnt; i++) {
+                if (kseq2 != NULL && merged[i].status != NOT_COMBINED) {
+                    reads.push_back(&merged[i].seq);
+                } else {
+                    reads.push_back(&mates1[i].seq);
+                    if (kseq2 != NULL) {
+                        reads.push_back(&mates2[i].seq);
+                    }
+                }
+            }
+            if (readOrfs.size() < reads.size()) {
+                readOrfs.resize(reads.size());
+            }
+            orfOffsets.resize(reads.size() + 1);
+
+#pragma omp parallel num_threads(workThreads)
+            {
+                Orf orf(par.translationTable, par.useAllTableStarts);
+                TranslateNucl translateNucl(static_cast<TranslateNucl::GenCode>(par.translationTable));
+                std::vector<Orf::SequenceLocation> locations;
+                std::string aa;
+
+#pragma omp for schedule(dynamic, 100)
+                for (size_t i = 0; i < reads.size(); i++) {
+                    ReadOrfs &out = readOrfs[i];
+                    out.clear();
+                    const std::string &seq = *reads[i];
+                    if (orf.setSequence(seq.c_str(), seq.size()) == false) {
+                        Debug(Debug::WARNING) << "Invalid sequence with key " << (readKey + i) << "\n";
+                        continue;
+                    }
+                    // long ORFs before start ORFs, as concatenated by assembledb
+                    for (size_t s = 0; s < 2; s++) {
+                        extractOrfs(orf, translateNucl, seq, readKey + i, orfSettings[s], forwardFrames, reverseFrames, addOrfStop, locations, aa, out);
+                    }
+                }
+            }
+
+            orfOffsets[0] = orfKey;
+            for (size_t i = 0; i < reads.size(); i++) {
+                orfOffsets[i + 1] = orfOffsets[i] + readOrfs[i].proteinEnds.size();
+            }
+
+#pragma omp parallel num_threads(workThreads)
+            {
+                unsigned int thread_idx = 0;
+#ifdef OPENMP
+                thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+
+#pragma omp for schedule(dynamic, 100)
+                for (size_t i = 0; i < reads.size(); i++) {
+                    const ReadOrfs &out = readOrfs[i];
+                    size_t proteinStart = 0;
+                    size_t headerStart = 0;
+                    for (size_t j = 0; j < out.proteinEnds.size(); j++) {
+                        unsigned int key = orfOffsets[i] + j;
+                        sequenceWriter.writeData(out.proteins.data() + proteinStart, out.proteinEnds[j] - proteinStart, key, thread_idx);
+                        headerWriter.writeData(out.headers.data() + headerStart, out.headerEnds[j] - headerStart, key, thread_idx);
+                        proteinStart = out.proteinEnds[j];
+                        headerStart = out.headerEnds[j];
+                    }
+                }
+            }
+            readKey += reads.size();
+            orfKey = orfOffsets[reads.size()];
+        }
+        delete kseq1;
+        delete kseq2;
+    }
+    headerWriter.close(true);
+    sequenceWriter.close(true);
+
+    Debug(Debug::INFO) << "Extracted " << orfKey << " ORFs from " << readKey << " sequences of " << readCnt << " reads\n";
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Debug.h"
+#include "Util.h"
+#include "LocalParameters.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+// select entries by protein filter scores written by filternoncoding or assembleresults --write-scores,
+// rejected entries are kept as empty entries, same as filternoncoding
+int selectbyscore(int argc, const char **argv, const Command& command) {
+    LocalParameters &par = LocalParameters::getLocalInstance();
+    par.parseParameters(argc, argv, command, true, 0, 0);
+
+    std::vector<std::string> thresholdStrings = Util::split(par.scoreThresholds, ",");
+    if (thresholdStrings.empty()) {
+        Debug(Debug::ERROR) << "No score threshold given\n";
+        EXIT(EXIT_FAILURE);
+    }
+    std::vector<float> thresholds;
+    for (size_t i = 0; i < thresholdStrings.size(); i++) {
+        thresholds.push_back(strtof(thresholdStrings[i].c_str(), NULL));
+    }
+
+    DBReader<unsigned int> seqDbr(par.db1.c_str(), par.db1Index.c_str(), par.threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
+    seqDbr.open(DBReader<unsigned int>::NOSORT);
+
+    DBReader<unsigned int> scoreDbr(par.db2.c_str(), par.db2Index.c_str(), par.threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
+    scoreDbr.open(DBReader<unsigned int>::NOSORT);
+
+    // a single threshold writes the output DB itself, a list writes <o:sequenceDB>_<threshold>
+    std::vector<DBWriter *> writers;
+    for (size_t i = 0; i < thresholds.size(); i++) {
+        std::string data = par.db3;
+        std::string index = par.db3Index;
+        if (thresholds.size() > 1) {
+            data = par.db3 + "_" + thresholdStrings[i];
+            index = data + ".index";
+        }
+        Debug(Debug::INFO) << "Output file for threshold " << thresholdStrings[i] << ": " << data << "\n";
+        DBWriter *writer = new DBWriter(data.c_str(), index.c_str(), par.threads, par.compressed, seqDbr.getDbtype());
+        writer->open();
+        writers.push_back(writer);
+    }
+
+    std::vector<size_t> acceptedCnt(thresholds.size(), 0);
+#pragma omp parallel
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = (unsigned int) omp_get_thread_num();
+#endif
+        std::vector<size_t> threadAcceptedCnt(thresholds.size(), 0);
+
+#pragma omp for schedule(dynamic, 10000)
+        for (size_t id = 0; id < seqDbr.getSize(); id++) {
+            unsigned int dbKey = seqDbr.getDbKey(id);
+            size_t scoreId = scoreDbr.getId(dbKey);
+            if (scoreId == UINT_MAX || scoreDbr.getEntryLen(scoreId) - 1 != sizeof(float)) {
+                Debug(Debug::ERROR) << "Could not find score of entry " << dbKey << " in " << par.db2 << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            float score;
+            memcpy(&score, scoreDbr.getData(scoreId, thread_idx), sizeof(float));
+
+            char *seqData = seqDbr.getData(id, thread_idx);
+            for (size_t i = 0; i < thresholds.size(); i++) {
+                if (score > thresholds[i]) {
+                    // -1 dont write \0 byte
+                    writers[i]->writeData(seqData, seqDbr.getEntryLen(id) - 1, dbKey, thread_idx);
+                    threadAcceptedCnt[i]++;
+                } else {
+                    writers[i]->writeData("\n", 1, dbKey, thread_idx);
+                }
+            }
+        }
+
+#pragma omp critical
+        {
+            for (size_t i = 0; i < thresholds.size(); i++) {
+                acceptedCnt[i] += threadAcceptedCnt[i];
+            }
+        }
+    }
+
+    for (size_t i = 0; i < thresholds.size(); i++) {
+        Debug(Debug::INFO) << "Threshold " << thresholdStrings[i] << ": " << acceptedCnt[i] << " out of " << seqDbr.getSize() << " entries selected\n";
+        writers[i]->close(true);
+        delete writers[i];
+    }
+    scoreDbr.close();
+    seqDbr.close();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,48 @@
+#include "AssemblyStats.h"
+#include "Debug.h"
+#include "FileUtil.h"
+#include "Util.h"
+
+#include <cstdio>
+
+double AssemblyStats::gain() const {
+    if (inputResidues == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(addedResidues) / static_cast<double>(inputResidues);
+}
+
+void AssemblyStats::write(const std::string &db, float convergeThreshold) const {
+    std::string statsFile = db + ".stats";
+    FILE *out = fopen(statsFile.c_str(), "w");
+    if (out == NULL) {
+        Debug(Debug::ERROR) << "Could not write " << statsFile << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    fprintf(out, "queries\t%zu\n", queries);
+    fprintf(out, "extended\t%zu\n", extended);
+    fprintf(out, "input_residues\t%zu\n", inputResidues);
+    fprintf(out, "added_residues\t%zu\n", addedResidues);
+    fprintf(out, "written\t%zu\n", written);
+    fprintf(out, "gain\t%.6f\n", gain());
+    if (fclose(out) != 0) {
+        Debug(Debug::ERROR) << "Could not write " << statsFile << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    std::string convergedFile = db + ".converged";
+    const bool converged = convergeThreshold > 0.0f && gain() < convergeThreshold;
+    if (converged) {
+        FILE *marker = fopen(convergedFile.c_str(), "w");
+        if (marker == NULL) {
+            Debug(Debug::ERROR) << "Could not write " << convergedFile << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        fclose(marker);
+    } else if (FileUtil::fileExists(convergedFile.c_str())) {
+        FileUtil::remove(convergedFile.c_str());
+    }
+
+    Debug(Debug::INFO) << "Extended " << extended << " of " << queries << " sequences by " << addedResidues
+                       << " residues (gain " << gain() << ")" << (converged ? ", converged" : "") << "\n";
+}
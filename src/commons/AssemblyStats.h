@@ -0,0 +1,27 @@
+#ifndef ASSEMBLYSTATS_H
+#define ASSEMBLYSTATS_H
+
+#include <cstddef>
+#include <string>
+
+// Statistics of one assembly iteration, counted from the wasExtended flags of assembleresults
+// and hybridassembleresults. The workflows use them to stop iterating once an iteration adds
+// only a small fraction of residues (see --converge-threshold).
+struct AssemblyStats {
+    size_t queries;
+    size_t extended;
+    size_t inputResidues;
+    size_t addedResidues;
+    size_t written;
+
+    AssemblyStats() : queries(0), extended(0), inputResidues(0), addedResidues(0), written(0) {}
+
+    // residues added by extensions relative to the input residues
+    double gain() const;
+
+    // writes the statistics as "name\tvalue" lines to <db>.stats and, if the gain is below
+    // convergeThreshold, the empty marker file <db>.converged (0.0: never converged)
+    void write(const std::string &db, float convergeThreshold) const;
+};
+
+#endif
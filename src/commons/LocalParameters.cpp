@@ -1,2 +1,23 @@
 #include "LocalParameters.h"
+#include "Util.h"
 
+#include <cstdlib>
+
+static std::string scheduleEntry(const std::string &schedule, int iteration) {
+    std::vector<std::string> values = Util::split(schedule, ",");
+    return values[std::min(static_cast<size_t>(iteration), values.size() - 1)];
+}
+
+int LocalParameters::scheduleValue(const std::string &schedule, int iteration, int value) {
+    if (schedule.empty()) {
+        return value;
+    }
+    return atoi(scheduleEntry(schedule, iteration).c_str());
+}
+
+float LocalParameters::scheduleValue(const std::string &schedule, int iteration, float value) {
+    if (schedule.empty()) {
+        return value;
+    }
+    return static_cast<float>(strtod(scheduleEntry(schedule, iteration).c_str(), NULL));
+}
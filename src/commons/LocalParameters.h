@@ -30,9 +30,16 @@ public:
     std::vector<MMseqsParameter *> assembleresults;
     std::vector<MMseqsParameter *> cyclecheck;
     std::vector<MMseqsParameter *> createhdb;
+    std::vector<MMseqsParameter *> virtualconcatdbs;
+    std::vector<MMseqsParameter *> selectentries;
     std::vector<MMseqsParameter *> extractorfssubset;
     std::vector<MMseqsParameter *> filternoncoding;
+    std::vector<MMseqsParameter *> selectbyscore;
+    std::vector<MMseqsParameter *> benchmarkfilter;
+    std::vector<MMseqsParameter *> readorfs;
     std::vector<MMseqsParameter *> hybridassembleresults;
+    std::vector<MMseqsParameter *> filterabsorbed;
+    std::vector<MMseqsParameter *> maskinterior;
     std::vector<MMseqsParameter *> reduceredundancy;
 
 
@@ -42,8 +49,33 @@ public:
     float clustSeqIdThr;
     float clustCovThr;
     float proteinFilterThreshold;
+    int proteinFilterQuant;
+    int proteinFilterCascade;
+    float proteinFilterCascadeError;
+    float pruneThreshold;
+    int pruneEvery;
+    float convergeThreshold;
+    int kmerEndWindow;
+    int writeScores;
+    int filterAssembly;
+    std::string scoreThresholds;
+    std::string filterModel;
+    std::string referenceModel;
     bool cycleCheck;
     bool chopCycle;
+    int skipAbsorbedReads;
+    int pairedEnd;
+    int streamOrfs;
+    std::string selectGrownFrom;
+    std::string selectMemberOf;
+    std::string selectNotMemberOf;
+    int selectMinLength;
+    int selectCompleteOrf;
+    int selectMatchAny;
+    std::string stepCache;
+    std::string kmerSizeSchedule;
+    std::string seqIdSchedule;
+    std::string kmersPerSequenceSchedule;
 
     MultiParam<int> multiNumIterations;
     MultiParam<int> multiKmerSize;
@@ -52,17 +84,46 @@ public:
 
     PARAMETER(PARAM_FILTER_PROTEINS)
     PARAMETER(PARAM_PROTEIN_FILTER_THRESHOLD)
+    PARAMETER(PARAM_PROTEIN_FILTER_QUANT)
+    PARAMETER(PARAM_PROTEIN_FILTER_CASCADE)
+    PARAMETER(PARAM_PROTEIN_FILTER_CASCADE_ERROR)
+    PARAMETER(PARAM_PRUNE_THRESHOLD)
+    PARAMETER(PARAM_PRUNE_EVERY)
+    PARAMETER(PARAM_CONVERGE_THRESHOLD)
+    PARAMETER(PARAM_KMER_END_WINDOW)
+    PARAMETER(PARAM_WRITE_SCORES)
+    PARAMETER(PARAM_FILTER_ASSEMBLY)
+    PARAMETER(PARAM_SCORE_THRESHOLDS)
+    PARAMETER(PARAM_FILTER_MODEL)
+    PARAMETER(PARAM_REFERENCE_MODEL)
     PARAMETER(PARAM_DELETE_TMP_INC)
     PARAMETER(PARAM_MIN_CONTIG_LEN)
     PARAMETER(PARAM_CLUST_MIN_SEQ_ID_THR)
     PARAMETER(PARAM_CLUST_C)
     PARAMETER(PARAM_CYCLE_CHECK)
     PARAMETER(PARAM_CHOP_CYCLE)
+    PARAMETER(PARAM_SKIP_ABSORBED_READS)
+    PARAMETER(PARAM_PAIRED_END)
+    PARAMETER(PARAM_STREAM_ORFS)
+    PARAMETER(PARAM_SELECT_GROWN_FROM)
+    PARAMETER(PARAM_SELECT_MEMBER_OF)
+    PARAMETER(PARAM_SELECT_NOT_MEMBER_OF)
+    PARAMETER(PARAM_SELECT_MIN_LENGTH)
+    PARAMETER(PARAM_SELECT_COMPLETE_ORF)
+    PARAMETER(PARAM_SELECT_MATCH_ANY)
+    PARAMETER(PARAM_STEP_CACHE)
+    PARAMETER(PARAM_K_SCHEDULE)
+    PARAMETER(PARAM_MIN_SEQ_ID_SCHEDULE)
+    PARAMETER(PARAM_KMER_PER_SEQ_SCHEDULE)
     PARAMETER(PARAM_MULTI_NUM_ITERATIONS)
     PARAMETER(PARAM_MULTI_K)
     PARAMETER(PARAM_MULTI_MIN_SEQ_ID)
     PARAMETER(PARAM_MULTI_MIN_ALN_LEN)
 
+    // value of a comma separated per-iteration schedule for the given iteration, the last value
+    // is kept for later iterations, an empty schedule keeps value
+    static int scheduleValue(const std::string &schedule, int iteration, int value);
+    static float scheduleValue(const std::string &schedule, int iteration, float value);
 
 private:
     LocalParameters() :
@@ -73,12 +134,37 @@ private:
             multiSeqIdThr(FLT_MAX,FLT_MAX),
             PARAM_FILTER_PROTEINS(PARAM_FILTER_PROTEINS_ID,"--filter-proteins", "Filter Proteins", "filter proteins by a neural network [0,1]",typeid(int), (void *) &filterProteins, "^[0-1]{1}$"),
             PARAM_PROTEIN_FILTER_THRESHOLD(PARAM_PROTEIN_FILTER_THRESHOLD_ID,"--protein-filter-threshold", "Protein Filter Threshold", "filter proteins lower than threshold [0.0,1.0]",typeid(float), (void *) &proteinFilterThreshold, "^0(\\.[0-9]+)?|1(\\.0+)?$"),
+            PARAM_PROTEIN_FILTER_QUANT(PARAM_PROTEIN_FILTER_QUANT_ID,"--protein-filter-quant", "Quantized protein filter", "Use int8 quantized inference for the protein filter, agreement to fp32 is reported on a sample [0,1]",typeid(int), (void *) &proteinFilterQuant, "^[0-1]{1}$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+            PARAM_PROTEIN_FILTER_CASCADE(PARAM_PROTEIN_FILTER_CASCADE_ID,"--protein-filter-cascade", "Protein filter cascade", "Decide clear cases by length and composition rules calibrated on a sample, only pass the rest to the protein filter network [0,1]",typeid(int), (void *) &proteinFilterCascade, "^[0-1]{1}$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+            PARAM_PROTEIN_FILTER_CASCADE_ERROR(PARAM_PROTEIN_FILTER_CASCADE_ERROR_ID,"--protein-filter-cascade-error", "Protein filter cascade error", "Max. fraction of calibration sequences the cascade rules may decide differently than the network [0.0,1.0]",typeid(float), (void *) &proteinFilterCascadeError, "^0(\\.[0-9]+)?|1(\\.0+)?$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+            PARAM_PRUNE_THRESHOLD(PARAM_PRUNE_THRESHOLD_ID,"--prune-threshold", "Prune threshold", "Drop fragments that could not be extended and have a protein filter score below threshold from the next iteration (0.0: no pruning) [0.0,1.0]",typeid(float), (void *) &pruneThreshold, "^0(\\.[0-9]+)?|1(\\.0+)?$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+            PARAM_PRUNE_EVERY(PARAM_PRUNE_EVERY_ID,"--prune-every", "Prune every n-th iteration", "Prune after every n-th assembly iteration, the last one is never pruned (see --prune-threshold) [1,inf]",typeid(int), (void *) &pruneEvery, "^[1-9]{1}[0-9]*$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+            PARAM_CONVERGE_THRESHOLD(PARAM_CONVERGE_THRESHOLD_ID,"--converge-threshold", "Convergence threshold", "Stop iterating once an iteration adds fewer residues than this fraction of its input, the last iteration still runs (0.0: run all iterations) [0.0,1.0]",typeid(float), (void *) &convergeThreshold, "^0(\\.[0-9]+)?|1(\\.0+)?$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+            PARAM_KMER_END_WINDOW(PARAM_KMER_END_WINDOW_ID,"--kmer-end-window", "K-mer end window", "Sample k-mers only from the first and last N residues of longer sequences by masking the rest with X, relies on kmermatcher skipping k-mers with X (MMseqs2), 0 samples the whole sequence [0, inf]",typeid(int), (void *) &kmerEndWindow, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+            PARAM_WRITE_SCORES(PARAM_WRITE_SCORES_ID,"--write-scores", "Write scores", "Write the protein filter score of each entry to <o:sequenceDB>_scores, see selectbyscore. assembleresults then keeps all entries [0,1]",typeid(int), (void *) &writeScores, "^[0-1]{1}$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+            PARAM_FILTER_ASSEMBLY(PARAM_FILTER_ASSEMBLY_ID,"--filter-assembly", "Filter assembly", "Score written entries with the protein filter and drop those below --protein-filter-threshold [0,1]",typeid(int), (void *) &filterAssembly, "^[0-1]{1}$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+            PARAM_SCORE_THRESHOLDS(PARAM_SCORE_THRESHOLDS_ID,"--score-thresholds", "Score thresholds", "Comma separated list of protein filter thresholds, one output DB is written per threshold",typeid(std::string), (void *) &scoreThresholds, "^(0(\\.[0-9]+)?|1(\\.0+)?)(,(0(\\.[0-9]+)?|1(\\.0+)?))*$"),
+            PARAM_FILTER_MODEL(PARAM_FILTER_MODEL_ID,"--filter-model", "Protein filter model", "Name of an embedded protein filter model (predict_coding_acc9260_56x96, predict_coding_acc9540_57x32x64, predict_coding_acc9598_57x32x64, predict_coding_acc9623_57x32x64, predict_coding_acc9642_57x32x64, predict_coding_acc9743_57x32x64) or path to a kerasify model",typeid(std::string), (void *) &filterModel, "", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+            PARAM_REFERENCE_MODEL(PARAM_REFERENCE_MODEL_ID,"--reference-model", "Reference protein filter model", "Protein filter model the --filter-model is compared to (see --filter-model)",typeid(std::string), (void *) &referenceModel, ""),
             PARAM_DELETE_TMP_INC(PARAM_DELETE_TMP_INC_ID,"--delete-tmp-inc", "Delete temporary files incremental", "Delete temporary files incremental [0,1]",typeid(int), (void *) &deleteFilesInc, "^[0-1]{1}$", MMseqsParameter::COMMAND_COMMON | MMseqsParameter::COMMAND_EXPERT),
             PARAM_MIN_CONTIG_LEN(PARAM_MIN_CONTIG_LEN_ID, "--min-contig-len", "Minimum contig length", "Minimum length of assembled contig to output", typeid(int), (void *) &minContigLen, "^[1-9]{1}[0-9]*$"),
             PARAM_CLUST_MIN_SEQ_ID_THR(PARAM_CLUST_MIN_SEQ_ID_THR_ID,"--clust-min-seq-id", "Clustering seq. id. threshold","Seq. id. threshold passed to linclust algorithm to reduce redundancy in assembly (range 0.0-1.0)",typeid(float), (void *) &clustSeqIdThr, "^0(\\.[0-9]+)?|1(\\.0+)?$", MMseqsParameter::COMMAND_CLUST),
             PARAM_CLUST_C(PARAM_CLUST_C_ID,"--clust-min-cov", "Clustering coverage threshold","Coverage threshold passed to linclust algorithm to reduce redundancy in assembly (range 0.0-1.0)",typeid(float), (void *) &clustCovThr, "^0(\\.[0-9]+)?|1(\\.0+)?$", MMseqsParameter::COMMAND_CLUST),
             PARAM_CYCLE_CHECK(PARAM_CYCLE_CHECK_ID,"--cycle-check", "Check for circular sequences", "Check for circular sequences (avoid infinite extension of circular or long repeated regions) ",typeid(bool), (void *) &cycleCheck, "", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
             PARAM_CHOP_CYCLE(PARAM_CHOP_CYCLE_ID,"--chop-cycle", "Chop Cycle", "Remove superfluous part of circular fragments (see --cycle-check)",typeid(bool), (void *) &chopCycle, "", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+            PARAM_SKIP_ABSORBED_READS(PARAM_SKIP_ABSORBED_READS_ID,"--skip-absorbed-reads", "Skip absorbed reads", "Pass only contigs and reads not absorbed by the protein level assembly to the nucleotide level assembly, reads with flanks beyond the absorbed ORF are kept [0,1]",typeid(int), (void *) &skipAbsorbedReads, "^[0-1]{1}$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+            PARAM_PAIRED_END(PARAM_PAIRED_END_ID,"--paired-end", "Paired-end reads", "Read files are pairs of mates, overlapping pairs are merged [0,1]",typeid(int), (void *) &pairedEnd, "^[0-1]{1}$"),
+            PARAM_STREAM_ORFS(PARAM_STREAM_ORFS_ID,"--stream-orfs", "Stream ORFs from reads", "Extract and translate ORFs directly from the read files with readorfs instead of writing a nucleotide read DB first [0,1]",typeid(int), (void *) &streamOrfs, "^[0-1]{1}$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+            PARAM_SELECT_GROWN_FROM(PARAM_SELECT_GROWN_FROM_ID,"--grown-from", "Select grown entries", "Select entries that are longer than the entry with the same key in this DB",typeid(std::string), (void *) &selectGrownFrom, ""),
+            PARAM_SELECT_MEMBER_OF(PARAM_SELECT_MEMBER_OF_ID,"--member-of", "Select members", "Select entries whose key is in this DB",typeid(std::string), (void *) &selectMemberOf, ""),
+            PARAM_SELECT_NOT_MEMBER_OF(PARAM_SELECT_NOT_MEMBER_OF_ID,"--not-member-of", "Select non-members", "Select entries whose key is not in this DB",typeid(std::string), (void *) &selectNotMemberOf, ""),
+            PARAM_SELECT_MIN_LENGTH(PARAM_SELECT_MIN_LENGTH_ID,"--min-entry-len", "Minimum entry length", "Select entries with at least this sequence length (0: no length selection)",typeid(int), (void *) &selectMinLength, "^[0-9]{1}[0-9]*$"),
+            PARAM_SELECT_COMPLETE_ORF(PARAM_SELECT_COMPLETE_ORF_ID,"--complete-orf", "Select complete proteins", "Select proteins with a * at start and end [0,1]",typeid(int), (void *) &selectCompleteOrf, "^[0-1]{1}$"),
+            PARAM_SELECT_MATCH_ANY(PARAM_SELECT_MATCH_ANY_ID,"--match-any", "Match any predicate", "Select entries that fulfill any instead of all given predicates [0,1]",typeid(int), (void *) &selectMatchAny, "^[0-1]{1}$"),
+            PARAM_STEP_CACHE(PARAM_STEP_CACHE_ID,"--step-cache", "Step cache directory", "Keep the output of each assembly step in this directory, keyed by its input and parameters, and reuse it in later runs (empty: no step cache)",typeid(std::string), (void *) &stepCache, "", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+            PARAM_K_SCHEDULE(PARAM_K_SCHEDULE_ID,"--k-schedule", "k-mer length schedule", "Comma separated k-mer length per assembly iteration, the last value is kept for later iterations (empty: -k for all iterations)",typeid(std::string), (void *) &kmerSizeSchedule, "^([1-9][0-9]*(,[1-9][0-9]*)*)?$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+            PARAM_MIN_SEQ_ID_SCHEDULE(PARAM_MIN_SEQ_ID_SCHEDULE_ID,"--min-seq-id-schedule", "Seq. id. threshold schedule", "Comma separated overlap sequence identity threshold per assembly iteration, the last value is kept for later iterations (empty: --min-seq-id for all iterations)",typeid(std::string), (void *) &seqIdSchedule, "^((0?\\.[0-9]+|0|1(\\.0+)?)(,(0?\\.[0-9]+|0|1(\\.0+)?))*)?$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+            PARAM_KMER_PER_SEQ_SCHEDULE(PARAM_KMER_PER_SEQ_SCHEDULE_ID,"--kmer-per-seq-schedule", "k-mers per sequence schedule", "Comma separated k-mers per sequence per assembly iteration, the last value is kept for later iterations (empty: --kmer-per-seq for all iterations)",typeid(std::string), (void *) &kmersPerSequenceSchedule, "^([1-9][0-9]*(,[1-9][0-9]*)*)?$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
             PARAM_MULTI_NUM_ITERATIONS(PARAM_MULTI_NUM_ITERATIONS_ID, "--num-iterations", "Number of assembly iterations","Number of assembly iterations performed on nucleotide level,protein level (range 1-inf)",typeid(MultiParam<int>),(void *) &multiNumIterations, ""),
             PARAM_MULTI_K(PARAM_MULTI_K_ID, "-k", "k-mer length", "k-mer length (0: automatically set to optimum)", typeid(MultiParam<int>), (void *) &multiKmerSize, "", MMseqsParameter::COMMAND_CLUSTLINEAR | MMseqsParameter::COMMAND_EXPERT),
             PARAM_MULTI_MIN_SEQ_ID(PARAM_MULTI_MIN_SEQ_ID_ID, "--min-seq-id", "Seq. id. threshold", "Overlap sequence identity threshold [0.0, 1.0]", typeid(MultiParam<float>), (void *) &multiSeqIdThr, "", MMseqsParameter::COMMAND_ALIGN),
@@ -92,6 +178,13 @@ private:
         assembleresults.push_back(&PARAM_THREADS);
         assembleresults.push_back(&PARAM_V);
         assembleresults.push_back(&PARAM_RESCORE_MODE); //temporary added until assemble and nuclassemble use same rescoremode
+        assembleresults.push_back(&PARAM_PRUNE_THRESHOLD);
+        assembleresults.push_back(&PARAM_FILTER_ASSEMBLY);
+        assembleresults.push_back(&PARAM_PROTEIN_FILTER_THRESHOLD);
+        assembleresults.push_back(&PARAM_PROTEIN_FILTER_QUANT);
+        assembleresults.push_back(&PARAM_FILTER_MODEL);
+        assembleresults.push_back(&PARAM_WRITE_SCORES);
+        assembleresults.push_back(&PARAM_CONVERGE_THRESHOLD);
 
         extractorfssubset.push_back(&PARAM_TRANSLATION_TABLE);
         extractorfssubset.push_back(&PARAM_USE_ALL_TABLE_STARTS);
@@ -99,9 +192,30 @@ private:
         extractorfssubset.push_back(&PARAM_V);
 
         filternoncoding.push_back(&PARAM_PROTEIN_FILTER_THRESHOLD);
+        filternoncoding.push_back(&PARAM_PROTEIN_FILTER_QUANT);
+        filternoncoding.push_back(&PARAM_PROTEIN_FILTER_CASCADE);
+        filternoncoding.push_back(&PARAM_PROTEIN_FILTER_CASCADE_ERROR);
+        filternoncoding.push_back(&PARAM_WRITE_SCORES);
+        filternoncoding.push_back(&PARAM_FILTER_MODEL);
+        filternoncoding.push_back(&PARAM_COMPRESSED);
         filternoncoding.push_back(&PARAM_THREADS);
         filternoncoding.push_back(&PARAM_V);
 
+        selectbyscore.push_back(&PARAM_SCORE_THRESHOLDS);
+        selectbyscore.push_back(&PARAM_THREADS);
+        selectbyscore.push_back(&PARAM_COMPRESSED);
+        selectbyscore.push_back(&PARAM_V);
+
+        benchmarkfilter.push_back(&PARAM_FILTER_MODEL);
+        benchmarkfilter.push_back(&PARAM_REFERENCE_MODEL);
+        benchmarkfilter.push_back(&PARAM_PROTEIN_FILTER_THRESHOLD);
+        benchmarkfilter.push_back(&PARAM_PROTEIN_FILTER_QUANT);
+        benchmarkfilter.push_back(&PARAM_THREADS);
+        benchmarkfilter.push_back(&PARAM_V);
+
+        readorfs = combineList(extractorfs, translatenucs);
+        readorfs.push_back(&PARAM_PAIRED_END);
+
         //cyclecheck
         cyclecheck.push_back(&PARAM_MAX_SEQ_LEN);
         cyclecheck.push_back(&PARAM_CHOP_CYCLE);
@@ -112,6 +226,21 @@ private:
         createhdb.push_back(&PARAM_COMPRESSED);
         createhdb.push_back(&PARAM_V);
 
+        //virtualconcatdbs
+        virtualconcatdbs.push_back(&PARAM_PRESERVEKEYS);
+        virtualconcatdbs.push_back(&PARAM_COMPRESSED);
+        virtualconcatdbs.push_back(&PARAM_V);
+
+        //selectentries
+        selectentries.push_back(&PARAM_SELECT_GROWN_FROM);
+        selectentries.push_back(&PARAM_SELECT_MEMBER_OF);
+        selectentries.push_back(&PARAM_SELECT_NOT_MEMBER_OF);
+        selectentries.push_back(&PARAM_SELECT_MIN_LENGTH);
+        selectentries.push_back(&PARAM_SELECT_COMPLETE_ORF);
+        selectentries.push_back(&PARAM_SELECT_MATCH_ANY);
+        selectentries.push_back(&PARAM_THREADS);
+        selectentries.push_back(&PARAM_V);
+
         //reduceredundancy (subset of clustering parameters which have to be adjusted)
         reduceredundancy.push_back(&PARAM_ALPH_SIZE);
         reduceredundancy.push_back(&PARAM_CLUSTER_MODE);
@@ -138,17 +267,30 @@ private:
 
         assembleDBworkflow.push_back(&PARAM_FILTER_PROTEINS);
         assembleDBworkflow.push_back(&PARAM_NUM_ITERATIONS);
+        assembleDBworkflow.push_back(&PARAM_PRUNE_EVERY);
         assembleDBworkflow.push_back(&PARAM_DELETE_TMP_INC);
         assembleDBworkflow.push_back(&PARAM_REMOVE_TMP_FILES);
         assembleDBworkflow.push_back(&PARAM_RUNNER);
+        assembleDBworkflow.push_back(&PARAM_STEP_CACHE);
+        assembleDBworkflow.push_back(&PARAM_K_SCHEDULE);
+        assembleDBworkflow.push_back(&PARAM_MIN_SEQ_ID_SCHEDULE);
+        assembleDBworkflow.push_back(&PARAM_KMER_PER_SEQ_SCHEDULE);
+        assembleDBworkflow.push_back(&PARAM_KMER_END_WINDOW);
 
         // easyassembleworkflow
         assemblerworkflow = combineList(assembleDBworkflow, createdb);
+        assemblerworkflow.push_back(&PARAM_STREAM_ORFS);
         
         // nucl assembledb workflow
         nuclassembleDBworkflow = combineList(rescorediagonal, kmermatcher);
         nuclassembleDBworkflow = combineList(nuclassembleDBworkflow, assembleresults);
         nuclassembleDBworkflow = combineList(nuclassembleDBworkflow, cyclecheck);
+        // the protein filter can only prune amino acid fragments
+        nuclassembleDBworkflow = removeParameter(nuclassembleDBworkflow, PARAM_PRUNE_THRESHOLD);
+        nuclassembleDBworkflow = removeParameter(nuclassembleDBworkflow, PARAM_FILTER_ASSEMBLY);
+        nuclassembleDBworkflow = removeParameter(nuclassembleDBworkflow, PARAM_PROTEIN_FILTER_THRESHOLD);
+        nuclassembleDBworkflow = removeParameter(nuclassembleDBworkflow, PARAM_FILTER_MODEL);
+        nuclassembleDBworkflow = removeParameter(nuclassembleDBworkflow, PARAM_WRITE_SCORES);
 
         nuclassembleDBworkflow.push_back(&PARAM_CYCLE_CHECK);
         nuclassembleDBworkflow.push_back(&PARAM_MIN_CONTIG_LEN);
@@ -156,6 +298,7 @@ private:
         nuclassembleDBworkflow.push_back(&PARAM_REMOVE_TMP_FILES);
         nuclassembleDBworkflow.push_back(&PARAM_DELETE_TMP_INC);
         nuclassembleDBworkflow.push_back(&PARAM_RUNNER);
+        nuclassembleDBworkflow.push_back(&PARAM_STEP_CACHE);
 
         // easynuclassembleworkflow
         nuclassemblerworkflow = combineList(nuclassembleDBworkflow, createdb);
@@ -166,6 +309,19 @@ private:
         hybridassembleresults.push_back(&PARAM_RESCORE_MODE);
         hybridassembleresults.push_back(&PARAM_THREADS);
         hybridassembleresults.push_back(&PARAM_V);
+        hybridassembleresults.push_back(&PARAM_SKIP_ABSORBED_READS);
+        hybridassembleresults.push_back(&PARAM_CONVERGE_THRESHOLD);
+
+        // filterabsorbed
+        filterabsorbed.push_back(&PARAM_THREADS);
+        filterabsorbed.push_back(&PARAM_COMPRESSED);
+        filterabsorbed.push_back(&PARAM_V);
+
+        // maskinterior
+        maskinterior.push_back(&PARAM_KMER_END_WINDOW);
+        maskinterior.push_back(&PARAM_COMPRESSED);
+        maskinterior.push_back(&PARAM_THREADS);
+        maskinterior.push_back(&PARAM_V);
 
         // hybridassembledbworkflow
         hybridassembleDBworkflow = combineList(extractorfs, hybridassembleresults);
@@ -190,11 +346,36 @@ private:
         filterProteins = 1;
         deleteFilesInc = 1;
         proteinFilterThreshold = 0.2;
+        proteinFilterQuant = 0;
+        proteinFilterCascade = 0;
+        proteinFilterCascadeError = 0.001;
+        pruneThreshold = 0.0;
+        pruneEvery = 1;
+        convergeThreshold = 0.0;
+        kmerEndWindow = 0;
+        writeScores = 0;
+        filterAssembly = 0;
+        scoreThresholds = "0.2";
+        filterModel = "predict_coding_acc9743_57x32x64";
+        referenceModel = "predict_coding_acc9743_57x32x64";
         clustSeqIdThr = 0.97;
         clustCovThr = 0.99;
         minContigLen = 1000;
         chopCycle = false;
         cycleCheck = true;
+        skipAbsorbedReads = 0;
+        pairedEnd = 0;
+        streamOrfs = 0;
+        selectGrownFrom = "";
+        selectMemberOf = "";
+        selectNotMemberOf = "";
+        selectMinLength = 0;
+        selectCompleteOrf = 0;
+        selectMatchAny = 0;
+        stepCache = "";
+        kmerSizeSchedule = "";
+        seqIdSchedule = "";
+        kmersPerSequenceSchedule = "";
 
         multiNumIterations = MultiParam<int>(12,20);
         multiKmerSize = MultiParam<int>(14,22);
@@ -0,0 +1,101 @@
+#include "OverlayDBWriter.h"
+#include "Debug.h"
+#include "FileUtil.h"
+#include "Util.h"
+
+#include <cstdio>
+
+OverlayDBWriter::OverlayDBWriter(DBReader<unsigned int> &base, const char *dataFileName, const char *indexFileName,
+                                 unsigned int threads, int dbtype)
+        : base(base), dataFileName(dataFileName), indexFileName(indexFileName),
+          deltaFileName(std::string(dataFileName) + "_delta"),
+          delta(deltaFileName.c_str(), (deltaFileName + ".index").c_str(), threads, base.isCompressed(), dbtype) {}
+
+void OverlayDBWriter::open() {
+    removeDatafiles(dataFileName);
+    delta.open();
+}
+
+void OverlayDBWriter::writeData(const char *data, size_t dataSize, unsigned int key, unsigned int thread_idx) {
+    delta.writeData(data, dataSize, key, thread_idx);
+}
+
+void OverlayDBWriter::close() {
+    delta.close(true);
+
+    size_t linkCnt = 0;
+    size_t deltaOffset = linkDatafiles(base.getDataFileName(), dataFileName, linkCnt);
+    std::string deltaLink = dataFileName + "." + SSTR(linkCnt);
+    if (std::rename(deltaFileName.c_str(), deltaLink.c_str()) != 0) {
+        Debug(Debug::ERROR) << "Could not move " << deltaFileName << " to " << deltaLink << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    DBReader<unsigned int> deltaReader(deltaLink.c_str(), (deltaFileName + ".index").c_str(), 1, DBReader<unsigned int>::USE_INDEX);
+    deltaReader.open(DBReader<unsigned int>::NOSORT);
+    FILE *out = fopen(indexFileName.c_str(), "w");
+    if (out == NULL) {
+        Debug(Debug::ERROR) << "Could not write " << indexFileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    // both indices are sorted by key
+    size_t baseId = 0;
+    size_t deltaId = 0;
+    size_t replacedCnt = 0;
+    while (baseId < base.getSize() || deltaId < deltaReader.getSize()) {
+        const unsigned int baseKey = baseId < base.getSize() ? base.getDbKey(baseId) : UINT_MAX;
+        const unsigned int deltaKey = deltaId < deltaReader.getSize() ? deltaReader.getDbKey(deltaId) : UINT_MAX;
+        if (deltaId < deltaReader.getSize() && deltaKey <= baseKey) {
+            fprintf(out, "%u\t%zu\t%zu\n", deltaKey, deltaOffset + deltaReader.getOffset(deltaId), deltaReader.getEntryLen(deltaId));
+            if (baseId < base.getSize() && deltaKey == baseKey) {
+                baseId++;
+                replacedCnt++;
+            }
+            deltaId++;
+        } else {
+            fprintf(out, "%u\t%zu\t%zu\n", baseKey, base.getOffset(baseId), base.getEntryLen(baseId));
+            baseId++;
+        }
+    }
+    if (fclose(out) != 0) {
+        Debug(Debug::ERROR) << "Could not write " << indexFileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    Debug(Debug::INFO) << "Overlay replaces " << replacedCnt << " and adds " << (deltaReader.getSize() - replacedCnt)
+                       << " entries of " << base.getSize() << " base entries\n";
+    deltaReader.close();
+
+    FileUtil::remove((deltaFileName + ".index").c_str());
+    // the dbtype file is moved last, it marks the DB as complete
+    FileUtil::move((deltaFileName + ".dbtype").c_str(), (dataFileName + ".dbtype").c_str());
+}
+
+void OverlayDBWriter::checkCompression(bool wasSet, int compressed, DBReader<unsigned int> &base) {
+    if (wasSet && (compressed != 0) != base.isCompressed()) {
+        Debug(Debug::ERROR) << "--compressed " << compressed << " does not match the compression of " << base.getDataFileName()
+                            << ", the output links its data files\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
+void OverlayDBWriter::removeDatafiles(const std::string &db) {
+    std::vector<std::string> dataFiles = FileUtil::findDatafiles(db.c_str());
+    for (size_t i = 0; i < dataFiles.size(); i++) {
+        FileUtil::remove(dataFiles[i].c_str());
+    }
+}
+
+size_t OverlayDBWriter::linkDatafiles(const std::string &db, const std::string &outDb, size_t &linkCnt) {
+    std::vector<std::string> dataFiles = FileUtil::findDatafiles(db.c_str());
+    if (dataFiles.empty()) {
+        Debug(Debug::ERROR) << "Could not find data file of " << db << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    size_t dataSize = 0;
+    for (size_t i = 0; i < dataFiles.size(); i++) {
+        FileUtil::symlinkAbs(dataFiles[i], outDb + "." + SSTR(linkCnt));
+        dataSize += FileUtil::getFileSize(dataFiles[i]);
+        linkCnt++;
+    }
+    return dataSize;
+}
@@ -0,0 +1,44 @@
+#ifndef OVERLAYDBWRITER_H
+#define OVERLAYDBWRITER_H
+
+#include "DBReader.h"
+#include "DBWriter.h"
+
+#include <string>
+
+// Writes a DB that differs from a base DB in a few entries. Only the written entries are
+// stored, in a delta data file. On close, the data files of the base DB are linked as the
+// first data files of a multi-file DB and the delta data file is appended, the index refers
+// to the delta for written keys and to the base data for all other keys. DBReader reads the
+// result like any other DB, the base DB has to stay in place as long as it is used.
+class OverlayDBWriter {
+public:
+    // the delta inherits the compression of the base DB
+    OverlayDBWriter(DBReader<unsigned int> &base, const char *dataFileName, const char *indexFileName,
+                    unsigned int threads, int dbtype);
+
+    void open();
+
+    // replaces or adds the entry with key, at most once per key
+    void writeData(const char *data, size_t dataSize, unsigned int key, unsigned int thread_idx);
+
+    void close();
+
+    // exits if --compressed was given and does not match the base DB, whose data files are linked as they are
+    static void checkCompression(bool wasSet, int compressed, DBReader<unsigned int> &base);
+
+    // removes all data files of db, a single data file would hide multi-file data files
+    static void removeDatafiles(const std::string &db);
+
+    // links the data files of db as <outDb>.<linkCnt>, ..., returns their total size
+    static size_t linkDatafiles(const std::string &db, const std::string &outDb, size_t &linkCnt);
+
+private:
+    DBReader<unsigned int> &base;
+    std::string dataFileName;
+    std::string indexFileName;
+    std::string deltaFileName;
+    DBWriter delta;
+};
+
+#endif
@@ -0,0 +1,288 @@
+#include "ParallelGzipReader.h"
+#include "Debug.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#include "kseq.h"
+
+namespace KSEQPARALLELGZIP {
+    KSEQ_INIT(ParallelGzipReader*, ParallelGzipReader::kseqRead)
+}
+
+static const size_t BGZF_HEADER_SIZE = 18;
+// inflate this many BGZF blocks (at most 64 KB output each) per parallel batch
+static const size_t BGZF_BLOCKS_PER_THREAD = 16;
+static const size_t STREAM_IN_SIZE = 1024 * 1024;
+static const size_t STREAM_OUT_SIZE = 4 * 1024 * 1024;
+
+static unsigned int readLE16(const unsigned char *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int readLE32(const unsigned char *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+// returns the total size of the BGZF block starting with header, 0 if it is no BGZF block
+static size_t bgzfBlockSize(const unsigned char *header) {
+    if (header[0] != 31 || header[1] != 139 || header[2] != 8 || (header[3] & 4) == 0) {
+        return 0;
+    }
+    // the BC subfield is the only extra subfield written by bgzip
+    if (readLE16(header + 10) != 6 || header[12] != 'B' || header[13] != 'C' || readLE16(header + 14) != 2) {
+        return 0;
+    }
+    return readLE16(header + 16) + 1;
+}
+
+ParallelGzipReader::ParallelGzipReader(const char *fileName, int threads)
+        : fileName(fileName), threads(std::max(1, threads)), bgzf(false), finished(false), stopped(false), currentPos(0) {
+    file = fopen(fileName, "rb");
+    if (file == NULL) {
+        Debug(Debug::ERROR) << "Could not open " << fileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    unsigned char header[BGZF_HEADER_SIZE];
+    size_t headerLen = fread(header, 1, BGZF_HEADER_SIZE, file);
+    bgzf = headerLen == BGZF_HEADER_SIZE && bgzfBlockSize(header) != 0;
+    rewind(file);
+    worker = std::thread(&ParallelGzipReader::run, this);
+}
+
+ParallelGzipReader::~ParallelGzipReader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+    }
+    queueChanged.notify_all();
+    worker.join();
+    fclose(file);
+}
+
+int ParallelGzipReader::read(void *buf, int size) {
+    if (currentPos == current.size()) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (queue.empty() && finished == false) {
+            queueChanged.wait(lock);
+        }
+        if (queue.empty()) {
+            return 0;
+        }
+        current.swap(queue.front());
+        queue.pop_front();
+        currentPos = 0;
+        lock.unlock();
+        queueChanged.notify_all();
+    }
+    size_t len = std::min(static_cast<size_t>(size), current.size() - currentPos);
+    memcpy(buf, current.data() + currentPos, len);
+    currentPos += len;
+    return static_cast<int>(len);
+}
+
+void ParallelGzipReader::push(std::string &chunk) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (queue.size() >= MAX_QUEUED_CHUNKS && stopped == false) {
+        queueChanged.wait(lock);
+    }
+    if (stopped == false) {
+        queue.push_back(std::string());
+        queue.back().swap(chunk);
+    }
+    lock.unlock();
+    queueChanged.notify_all();
+}
+
+void ParallelGzipReader::run() {
+    if (bgzf) {
+        runBgzf();
+    } else {
+        runStream();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    queueChanged.notify_all();
+}
+
+bool ParallelGzipReader::readBgzfBlock(std::string &block) {
+    unsigned char header[BGZF_HEADER_SIZE];
+    size_t headerLen = fread(header, 1, BGZF_HEADER_SIZE, file);
+    if (headerLen == 0) {
+        return false;
+    }
+    size_t blockSize = (headerLen == BGZF_HEADER_SIZE) ? bgzfBlockSize(header) : 0;
+    if (blockSize < BGZF_HEADER_SIZE + 8) {
+        Debug(Debug::ERROR) << "Invalid BGZF block in " << fileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    block.resize(blockSize);
+    memcpy(&block[0], header, BGZF_HEADER_SIZE);
+    if (fread(&block[BGZF_HEADER_SIZE], 1, blockSize - BGZF_HEADER_SIZE, file) != blockSize - BGZF_HEADER_SIZE) {
+        Debug(Debug::ERROR) << "Truncated BGZF block in " << fileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    return true;
+}
+
+void ParallelGzipReader::runBgzf() {
+    const size_t batchSize = threads * BGZF_BLOCKS_PER_THREAD;
+    std::vector<std::string> blocks(batchSize);
+    std::vector<std::string> inflated(batchSize);
+    std::string chunk;
+    bool eof = false;
+    while (eof == false) {
+        size_t blockCnt = 0;
+        while (blockCnt < batchSize && readBgzfBlock(blocks[blockCnt])) {
+            blockCnt++;
+        }
+        eof = blockCnt < batchSize;
+
+        bool failed = false;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads) reduction(||:failed)
+        for (size_t i = 0; i < blockCnt; i++) {
+            const std::string &block = blocks[i];
+            const unsigned char *trailer = reinterpret_cast<const unsigned char *>(block.data() + block.size() - 8);
+            unsigned int expectedCrc = readLE32(trailer);
+            unsigned int inflatedSize = readLE32(trailer + 4);
+            inflated[i].resize(inflatedSize);
+            if (inflatedSize == 0) {
+                continue;
+            }
+
+            z_stream strm;
+            memset(&strm, 0, sizeof(z_stream));
+            // raw deflate data between header and trailer
+            bool ok = inflateInit2(&strm, -15) == Z_OK;
+            strm.next_in = (Bytef *) block.data() + BGZF_HEADER_SIZE;
+            strm.avail_in = block.size() - BGZF_HEADER_SIZE - 8;
+            strm.next_out = (Bytef *) &inflated[i][0];
+            strm.avail_out = inflatedSize;
+            ok = ok && inflate(&strm, Z_FINISH) == Z_STREAM_END && strm.avail_out == 0;
+            inflateEnd(&strm);
+            ok = ok && crc32(crc32(0L, Z_NULL, 0), (const Bytef *) inflated[i].data(), inflatedSize) == expectedCrc;
+            if (ok == false) {
+                failed = true;
+            }
+        }
+        if (failed) {
+            Debug(Debug::ERROR) << "Could not decompress BGZF block in " << fileName << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+
+        chunk.clear();
+        for (size_t i = 0; i < blockCnt; i++) {
+            chunk.append(inflated[i]);
+        }
+        if (chunk.empty() == false) {
+            push(chunk);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopped) {
+            break;
+        }
+    }
+}
+
+void ParallelGzipReader::runStream() {
+    z_stream strm;
+    memset(&strm, 0, sizeof(z_stream));
+    // 15 + 32: zlib or gzip with automatic header detection
+    if (inflateInit2(&strm, 15 + 32) != Z_OK) {
+        Debug(Debug::ERROR) << "Could not initialize zlib for " << fileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    std::string in(STREAM_IN_SIZE, '\0');
+    std::string chunk;
+    bool eof = false;
+    bool inMember = false;
+    bool outputFull = false;
+    bool stoppedEarly = false;
+    while (true) {
+        if (strm.avail_in == 0 && eof == false) {
+            size_t inLen = fread(&in[0], 1, in.size(), file);
+            eof = inLen < in.size();
+            strm.next_in = (Bytef *) &in[0];
+            strm.avail_in = inLen;
+        }
+        // inflate might hold back output if the last chunk was filled completely
+        if (strm.avail_in == 0 && outputFull == false) {
+            break;
+        }
+
+        chunk.resize(STREAM_OUT_SIZE);
+        strm.next_out = (Bytef *) &chunk[0];
+        strm.avail_out = chunk.size();
+        if (strm.avail_in > 0) {
+            inMember = true;
+        }
+        int status = inflate(&strm, Z_NO_FLUSH);
+        if (status == Z_STREAM_END) {
+            // the next gzip member starts right after this one
+            inflateReset(&strm);
+            inMember = false;
+        } else if (status != Z_OK && status != Z_BUF_ERROR) {
+            Debug(Debug::ERROR) << "Could not decompress " << fileName << ": " << (strm.msg != NULL ? strm.msg : "") << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        outputFull = strm.avail_out == 0;
+        chunk.resize(chunk.size() - strm.avail_out);
+        if (chunk.empty() == false) {
+            push(chunk);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopped) {
+            stoppedEarly = true;
+            break;
+        }
+    }
+    // a truncated file would otherwise be parsed as if it ended with a partial read
+    if (inMember && stoppedEarly == false) {
+        Debug(Debug::ERROR) << "Unexpected end of gzip file " << fileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    inflateEnd(&strm);
+}
+
+KSeqParallelGzip::KSeqParallelGzip(const char *fileName, int threads) : reader(fileName, threads) {
+    kseq = (void *) KSEQPARALLELGZIP::kseq_init(&reader);
+}
+
+KSeqParallelGzip::~KSeqParallelGzip() {
+    KSEQPARALLELGZIP::kseq_destroy((KSEQPARALLELGZIP::kseq_t *) kseq);
+}
+
+bool KSeqParallelGzip::ReadEntry() {
+    KSEQPARALLELGZIP::kseq_t *s = (KSEQPARALLELGZIP::kseq_t *) kseq;
+    if (KSEQPARALLELGZIP::kseq_read(s) < 0) {
+        return false;
+    }
+    entry.name = s->name;
+    entry.comment = s->comment;
+    entry.sequence = s->seq;
+    entry.qual = s->qual;
+    return true;
+}
+#endif
+
+KSeqWrapper *ParallelKSeqFactory(const char *fileName, int threads) {
+#ifdef HAVE_ZLIB
+    const size_t len = strlen(fileName);
+    if (len > 3 && strcmp(fileName + len - 3, ".gz") == 0) {
+        return new KSeqParallelGzip(fileName, threads);
+    }
+#else
+    (void) threads;
+#endif
+    return KSeqFactory(fileName);
+}
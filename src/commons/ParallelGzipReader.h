@@ -0,0 +1,81 @@
+#ifndef PARALLELGZIPREADER_H
+#define PARALLELGZIPREADER_H
+
+#include "KSeqWrapper.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef HAVE_ZLIB
+// Decompresses a gzip file on a background thread while the caller parses the
+// output. BGZF files (blocked gzip as written by bgzip) are split into their
+// independent blocks, which are inflated by threads in parallel. Other gzip
+// files, including multi-member ones, are inflated sequentially by the
+// background thread.
+class ParallelGzipReader {
+public:
+    ParallelGzipReader(const char *fileName, int threads);
+    ~ParallelGzipReader();
+
+    // copies up to size decompressed bytes to buf, returns 0 at the end of the file
+    int read(void *buf, int size);
+
+    // read callback for kseq
+    static int kseqRead(ParallelGzipReader *reader, void *buf, int size) {
+        return reader->read(buf, size);
+    }
+
+    bool isBgzf() const {
+        return bgzf;
+    }
+
+private:
+    void run();
+    void runBgzf();
+    void runStream();
+
+    // blocks until the queue has space, then adds the chunk
+    void push(std::string &chunk);
+
+    // reads the next BGZF block into block, returns false at the end of the file
+    bool readBgzfBlock(std::string &block);
+
+    std::string fileName;
+    FILE *file;
+    int threads;
+    bool bgzf;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable queueChanged;
+    std::deque<std::string> queue;
+    bool finished;
+    bool stopped;
+
+    std::string current;
+    size_t currentPos;
+
+    static const size_t MAX_QUEUED_CHUNKS = 4;
+};
+
+// KSeqWrapper over a ParallelGzipReader. Entry offsets are not tracked.
+class KSeqParallelGzip : public KSeqWrapper {
+public:
+    KSeqParallelGzip(const char *fileName, int threads);
+    ~KSeqParallelGzip();
+    bool ReadEntry();
+
+private:
+    ParallelGzipReader reader;
+    void *kseq;
+};
+#endif
+
+// like KSeqFactory, but gzip files are decompressed by a ParallelGzipReader
+KSeqWrapper *ParallelKSeqFactory(const char *fileName, int threads);
+
+#endif
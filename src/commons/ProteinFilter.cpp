@@ -0,0 +1,132 @@
+#include "ProteinFilter.h"
+#include "Debug.h"
+#include "Util.h"
+#include "FileUtil.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "predict_coding_acc9260_56x96.model.h"
+#include "predict_coding_acc9540_57x32x64.model.h"
+#include "predict_coding_acc9598_57x32x64.model.h"
+#include "predict_coding_acc9623_57x32x64.model.h"
+#include "predict_coding_acc9642_57x32x64.model.h"
+#include "predict_coding_acc9743_57x32x64.model.h"
+
+const char *ProteinFilter::DEFAULT_MODEL = "predict_coding_acc9743_57x32x64";
+
+struct EmbeddedModel {
+    const char *name;
+    const unsigned char *data;
+    unsigned int len;
+};
+
+static const EmbeddedModel embeddedModels[] = {
+        {"predict_coding_acc9260_56x96", predict_coding_acc9260_56x96_model, predict_coding_acc9260_56x96_model_len},
+        {"predict_coding_acc9540_57x32x64", predict_coding_acc9540_57x32x64_model, predict_coding_acc9540_57x32x64_model_len},
+        {"predict_coding_acc9598_57x32x64", predict_coding_acc9598_57x32x64_model, predict_coding_acc9598_57x32x64_model_len},
+        {"predict_coding_acc9623_57x32x64", predict_coding_acc9623_57x32x64_model, predict_coding_acc9623_57x32x64_model_len},
+        {"predict_coding_acc9642_57x32x64", predict_coding_acc9642_57x32x64_model, predict_coding_acc9642_57x32x64_model_len},
+        {"predict_coding_acc9743_57x32x64", predict_coding_acc9743_57x32x64_model, predict_coding_acc9743_57x32x64_model_len}
+};
+
+std::vector<std::string> ProteinFilter::getEmbeddedModelNames() {
+    std::vector<std::string> names;
+    for (size_t i = 0; i < sizeof(embeddedModels) / sizeof(embeddedModels[0]); i++) {
+        names.push_back(embeddedModels[i].name);
+    }
+    return names;
+}
+
+ProteinFilter::ProteinFilter(const std::string &matrixFile, const std::string &modelName, bool quantized)
+        : subMat(matrixFile.c_str(), 2.0, 0.0),
+          redMat7(subMat.probMatrix, subMat.subMatrixPseudoCounts, subMat.aa2num, subMat.num2aa, subMat.alphabetSize, 7, subMat.getBitFactor()),
+          inputSize(0), quantized(quantized) {
+    std::string modelData;
+    bool isEmbedded = false;
+    for (size_t i = 0; i < sizeof(embeddedModels) / sizeof(embeddedModels[0]); i++) {
+        if (modelName == embeddedModels[i].name) {
+            modelData = std::string((const char *) embeddedModels[i].data, embeddedModels[i].len);
+            isEmbedded = true;
+            break;
+        }
+    }
+    if (isEmbedded == false) {
+        if (FileUtil::fileExists(modelName.c_str()) == false) {
+            Debug(Debug::ERROR) << "Protein filter model " << modelName << " is neither an embedded model nor a file. Embedded models:\n";
+            std::vector<std::string> names = getEmbeddedModelNames();
+            for (size_t i = 0; i < names.size(); i++) {
+                Debug(Debug::ERROR) << "  " << names[i] << "\n";
+            }
+            EXIT(EXIT_FAILURE);
+        }
+        std::ifstream file(modelName.c_str(), std::ios::binary);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        modelData = buffer.str();
+    }
+    if (model.LoadModel(modelData) == false) {
+        Debug(Debug::ERROR) << "Could not load protein filter model " << modelName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    inputSize = model.InputSize();
+    if (inputSize != ProteinFilterFeatures::FEATURE_CNT && inputSize != ProteinFilterFeatures::FEATURE_CNT - 1) {
+        Debug(Debug::ERROR) << "Protein filter model " << modelName << " expects " << inputSize << " inputs, only "
+                            << ProteinFilterFeatures::FEATURE_CNT << " or " << (ProteinFilterFeatures::FEATURE_CNT - 1) << " are supported\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (quantized) {
+        if (quantModel.Quantize(model, inputSize, usesAllFeatures() ? 1 : 0) == false) {
+            Debug(Debug::ERROR) << "Could not quantize protein filter model " << modelName << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+    }
+}
+
+void ProteinFilter::extract(ProteinFilterFeatures *features, const char *seq, unsigned int seqLen, float *input) const {
+    if (usesAllFeatures()) {
+        features->extract(seq, seqLen, input);
+    } else {
+        float all[ProteinFilterFeatures::FEATURE_CNT];
+        features->extract(seq, seqLen, all);
+        std::copy(all + 1, all + ProteinFilterFeatures::FEATURE_CNT, input);
+    }
+}
+
+void ProteinFilter::predictRows(KerasBatch *batch, KerasQuantizedModel::Buffer *quantBuffer, size_t rows, float *scores) const {
+    if (quantized) {
+        for (size_t row = 0; row < rows; row++) {
+            if (quantModel.Apply(batch->Input(row), &scores[row], quantBuffer) == false) {
+                Debug(Debug::ERROR) << "Could not apply quantized protein filter model\n";
+                EXIT(EXIT_FAILURE);
+            }
+        }
+    } else {
+        if (model.ApplyBatch(batch, rows) == false) {
+            Debug(Debug::ERROR) << "Could not apply protein filter model\n";
+            EXIT(EXIT_FAILURE);
+        }
+        for (size_t row = 0; row < rows; row++) {
+            scores[row] = batch->Output(row)[0];
+        }
+    }
+}
+
+ProteinFilter::Scorer::Scorer(const ProteinFilter &filter) : filter(filter), features(filter.createFeatures()) {
+    if (filter.initBatch(&batch, 1) == false) {
+        Debug(Debug::ERROR) << "Could not initialize protein filter model\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
+ProteinFilter::Scorer::~Scorer() {
+    delete features;
+}
+
+float ProteinFilter::Scorer::score(const char *seq, unsigned int seqLen) {
+    float result;
+    filter.extract(features, seq, seqLen, batch.Input(0));
+    filter.predictRows(&batch, &quantBuffer, 1, &result);
+    return result;
+}
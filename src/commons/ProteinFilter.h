@@ -0,0 +1,82 @@
+#ifndef PROTEINFILTER_H
+#define PROTEINFILTER_H
+
+#include "SubstitutionMatrix.h"
+#include "ReducedMatrix.h"
+#include "ProteinFilterFeatures.h"
+
+#include "kerasify/keras_model.h"
+#include "kerasify/keras_quantized.h"
+
+#include <string>
+#include <vector>
+
+// Coding potential of protein sequences predicted by a neural network, shared
+// by all modules that filter or prune with it. The model is either one of the
+// embedded models (by name) or a kerasify model file. Models with one input
+// less than ProteinFilterFeatures::FEATURE_CNT do not use the length feature.
+class ProteinFilter {
+public:
+    static const char *DEFAULT_MODEL;
+
+    ProteinFilter(const std::string &matrixFile, const std::string &modelName, bool quantized);
+
+    static std::vector<std::string> getEmbeddedModelNames();
+
+    // writes the inputSize() model inputs of a sequence
+    void extract(ProteinFilterFeatures *features, const char *seq, unsigned int seqLen, float *input) const;
+
+    // scores the first rows inputs of the batch, KerasModel::ApplyBatch overwrites the inputs
+    void predictRows(KerasBatch *batch, KerasQuantizedModel::Buffer *quantBuffer, size_t rows, float *scores) const;
+
+    bool initBatch(KerasBatch *batch, int batchSize) const {
+        return model.InitBatch(batch, inputSize, batchSize);
+    }
+
+    ProteinFilterFeatures *createFeatures() const {
+        return new ProteinFilterFeatures(subMat, redMat7);
+    }
+
+    const KerasModel &getModel() const {
+        return model;
+    }
+
+    int getInputSize() const {
+        return inputSize;
+    }
+
+    // model inputs are the complete ProteinFilterFeatures (starting with the length)
+    bool usesAllFeatures() const {
+        return inputSize == ProteinFilterFeatures::FEATURE_CNT;
+    }
+
+    bool isQuantized() const {
+        return quantized;
+    }
+
+    // per thread scoring of single sequences
+    class Scorer {
+    public:
+        explicit Scorer(const ProteinFilter &filter);
+        ~Scorer();
+
+        float score(const char *seq, unsigned int seqLen);
+
+    private:
+        const ProteinFilter &filter;
+        ProteinFilterFeatures *features;
+        KerasBatch batch;
+        KerasQuantizedModel::Buffer quantBuffer;
+    };
+
+private:
+    SubstitutionMatrix subMat;
+    ReducedMatrix redMat7;
+    KerasModel model;
+    int inputSize;
+    // int8 inference, the length feature stays fp32
+    KerasQuantizedModel quantModel;
+    bool quantized;
+};
+
+#endif
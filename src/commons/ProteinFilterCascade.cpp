@@ -0,0 +1,211 @@
+#include "ProteinFilterCascade.h"
+#include "Debug.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+ProteinFilterCascade::ProteinFilterCascade()
+        : calibrated(false), maxRejectLen(-FLT_MAX), minAcceptLen(FLT_MAX),
+          maxRejectSurrogate(-FLT_MAX), minAcceptSurrogate(FLT_MAX) {
+    std::fill(weights, weights + SURROGATE_CNT, 0.0f);
+}
+
+const char *ProteinFilterCascade::decisionName(Decision decision) {
+    switch (decision) {
+        case REJECT_LENGTH:
+            return "length reject";
+        case ACCEPT_LENGTH:
+            return "length accept";
+        case REJECT_COMPOSITION:
+            return "composition reject";
+        case ACCEPT_COMPOSITION:
+            return "composition accept";
+        default:
+            return "network";
+    }
+}
+
+// largest cutoff such that at most maxErrors values <= cutoff are accepted by
+// the network, values are (value, accepted) sorted ascending
+static float rejectCutoff(const std::vector<std::pair<float, bool> > &values, size_t maxErrors) {
+    float cutoff = -FLT_MAX;
+    size_t errors = 0;
+    for (size_t i = 0; i < values.size(); i++) {
+        errors += values[i].second;
+        if (errors > maxErrors) {
+            break;
+        }
+        // only cut between distinct values
+        if (i + 1 == values.size() || values[i + 1].first != values[i].first) {
+            cutoff = values[i].first;
+        }
+    }
+    return cutoff;
+}
+
+static float acceptCutoff(const std::vector<std::pair<float, bool> > &values, size_t maxErrors) {
+    float cutoff = FLT_MAX;
+    size_t errors = 0;
+    for (size_t i = values.size(); i > 0; i--) {
+        errors += !values[i - 1].second;
+        if (errors > maxErrors) {
+            break;
+        }
+        if (i == 1 || values[i - 2].first != values[i - 1].first) {
+            cutoff = values[i - 1].first;
+        }
+    }
+    return cutoff;
+}
+
+static void surrogateInput(const float *features, double *x) {
+    x[0] = 1.0;
+    x[1] = std::log(1.0 + features[0]);
+    for (int i = 1; i < ProteinFilterFeatures::FEATURE_CNT; i++) {
+        x[i + 1] = features[i];
+    }
+}
+
+float ProteinFilterCascade::surrogate(const float *features) const {
+    float sum = weights[0] + weights[1] * std::log(1.0f + features[0]);
+    for (int i = 1; i < ProteinFilterFeatures::FEATURE_CNT; i++) {
+        sum += weights[i + 1] * features[i];
+    }
+    return sum;
+}
+
+bool ProteinFilterCascade::calibrate(const std::vector<float> &features, const std::vector<float> &scores,
+                                     float threshold, float maxError) {
+    const int featureCnt = ProteinFilterFeatures::FEATURE_CNT;
+    const size_t n = scores.size();
+    calibrated = false;
+    if (n == 0 || features.size() != n * featureCnt) {
+        return false;
+    }
+    const size_t maxErrors = static_cast<size_t>(maxError * n / 4.0f);
+
+    // length tier
+    std::vector<std::pair<float, bool> > values(n);
+    for (size_t i = 0; i < n; i++) {
+        values[i] = std::make_pair(features[i * featureCnt], scores[i] > threshold);
+    }
+    std::sort(values.begin(), values.end());
+    maxRejectLen = rejectCutoff(values, maxErrors);
+    minAcceptLen = acceptCutoff(values, maxErrors);
+    if (minAcceptLen <= maxRejectLen) {
+        minAcceptLen = FLT_MAX;
+    }
+
+    // composition tier: least squares fit of the network logit, small ridge for stability
+    std::vector<size_t> remaining;
+    for (size_t i = 0; i < n; i++) {
+        const float len = features[i * featureCnt];
+        if (len > maxRejectLen && len < minAcceptLen) {
+            remaining.push_back(i);
+        }
+    }
+    maxRejectSurrogate = -FLT_MAX;
+    minAcceptSurrogate = FLT_MAX;
+    std::fill(weights, weights + SURROGATE_CNT, 0.0f);
+    if (remaining.size() >= static_cast<size_t>(4 * SURROGATE_CNT)) {
+        std::vector<double> ata(SURROGATE_CNT * SURROGATE_CNT, 0.0);
+        std::vector<double> atb(SURROGATE_CNT, 0.0);
+        double x[SURROGATE_CNT];
+        for (size_t r = 0; r < remaining.size(); r++) {
+            const size_t i = remaining[r];
+            surrogateInput(&features[i * featureCnt], x);
+            const double p = std::min(1.0 - 1e-4, std::max(1e-4, static_cast<double>(scores[i])));
+            const double logit = std::log(p / (1.0 - p));
+            for (int a = 0; a < SURROGATE_CNT; a++) {
+                atb[a] += x[a] * logit;
+                for (int b = 0; b <= a; b++) {
+                    ata[a * SURROGATE_CNT + b] += x[a] * x[b];
+                }
+            }
+        }
+        for (int a = 0; a < SURROGATE_CNT; a++) {
+            ata[a * SURROGATE_CNT + a] += 1e-6 * remaining.size();
+        }
+        // Cholesky decomposition of the lower triangle, then forward and backward substitution
+        bool positive = true;
+        for (int j = 0; j < SURROGATE_CNT && positive; j++) {
+            double diag = ata[j * SURROGATE_CNT + j];
+            for (int k = 0; k < j; k++) {
+                diag -= ata[j * SURROGATE_CNT + k] * ata[j * SURROGATE_CNT + k];
+            }
+            if (diag <= 0.0) {
+                positive = false;
+                break;
+            }
+            diag = std::sqrt(diag);
+            ata[j * SURROGATE_CNT + j] = diag;
+            for (int i = j + 1; i < SURROGATE_CNT; i++) {
+                double sum = ata[i * SURROGATE_CNT + j];
+                for (int k = 0; k < j; k++) {
+                    sum -= ata[i * SURROGATE_CNT + k] * ata[j * SURROGATE_CNT + k];
+                }
+                ata[i * SURROGATE_CNT + j] = sum / diag;
+            }
+        }
+        if (positive) {
+            std::vector<double> y(SURROGATE_CNT);
+            std::vector<double> w(SURROGATE_CNT);
+            for (int i = 0; i < SURROGATE_CNT; i++) {
+                double sum = atb[i];
+                for (int k = 0; k < i; k++) {
+                    sum -= ata[i * SURROGATE_CNT + k] * y[k];
+                }
+                y[i] = sum / ata[i * SURROGATE_CNT + i];
+            }
+            for (int i = SURROGATE_CNT - 1; i >= 0; i--) {
+                double sum = y[i];
+                for (int k = i + 1; k < SURROGATE_CNT; k++) {
+                    sum -= ata[k * SURROGATE_CNT + i] * w[k];
+                }
+                w[i] = sum / ata[i * SURROGATE_CNT + i];
+            }
+            for (int i = 0; i < SURROGATE_CNT; i++) {
+                weights[i] = static_cast<float>(w[i]);
+            }
+
+            values.resize(remaining.size());
+            for (size_t r = 0; r < remaining.size(); r++) {
+                const size_t i = remaining[r];
+                values[r] = std::make_pair(surrogate(&features[i * featureCnt]), scores[i] > threshold);
+            }
+            std::sort(values.begin(), values.end());
+            maxRejectSurrogate = rejectCutoff(values, maxErrors);
+            minAcceptSurrogate = acceptCutoff(values, maxErrors);
+            if (minAcceptSurrogate <= maxRejectSurrogate) {
+                minAcceptSurrogate = FLT_MAX;
+            }
+        } else {
+            Debug(Debug::WARNING) << "Could not fit composition tier of protein filter cascade\n";
+        }
+    }
+
+    calibrated = true;
+    return true;
+}
+
+ProteinFilterCascade::Decision ProteinFilterCascade::decide(const float *features) const {
+    const float len = features[0];
+    if (len <= maxRejectLen) {
+        return REJECT_LENGTH;
+    }
+    if (len >= minAcceptLen) {
+        return ACCEPT_LENGTH;
+    }
+    if (maxRejectSurrogate != -FLT_MAX || minAcceptSurrogate != FLT_MAX) {
+        const float value = surrogate(features);
+        if (value <= maxRejectSurrogate) {
+            return REJECT_COMPOSITION;
+        }
+        if (value >= minAcceptSurrogate) {
+            return ACCEPT_COMPOSITION;
+        }
+    }
+    return UNDECIDED;
+}
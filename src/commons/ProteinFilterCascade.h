@@ -0,0 +1,60 @@
+#ifndef PROTEINFILTERCASCADE_H
+#define PROTEINFILTERCASCADE_H
+
+#include "ProteinFilterFeatures.h"
+
+#include <vector>
+
+// Cheap tiers in front of the protein filter network. Both tiers are
+// calibrated against network decisions on a sample of the input:
+// 1. length: accept/reject sequences longer/shorter than a length cutoff
+// 2. composition: a linear surrogate of the network logit on log length and
+//    the composition features, with accept/reject cutoffs on its value
+// The cutoffs are chosen so that each of the four rules disagrees with the
+// network on at most a quarter of the allowed error fraction of the sample.
+// Sequences that no rule decides are passed to the network.
+class ProteinFilterCascade {
+public:
+    enum Decision {
+        REJECT_LENGTH = 0,
+        ACCEPT_LENGTH,
+        REJECT_COMPOSITION,
+        ACCEPT_COMPOSITION,
+        UNDECIDED,
+        DECISION_CNT
+    };
+
+    ProteinFilterCascade();
+
+    // features: row major, ProteinFilterFeatures::FEATURE_CNT per sequence
+    // scores: network output per sequence
+    bool calibrate(const std::vector<float> &features, const std::vector<float> &scores,
+                   float threshold, float maxError);
+
+    Decision decide(const float *features) const;
+
+    bool isCalibrated() const {
+        return calibrated;
+    }
+
+    static bool isAccept(Decision decision) {
+        return decision == ACCEPT_LENGTH || decision == ACCEPT_COMPOSITION;
+    }
+
+    static const char *decisionName(Decision decision);
+
+private:
+    static const int SURROGATE_CNT = ProteinFilterFeatures::FEATURE_CNT + 1;
+
+    float surrogate(const float *features) const;
+
+    bool calibrated;
+    float maxRejectLen;
+    float minAcceptLen;
+    float maxRejectSurrogate;
+    float minAcceptSurrogate;
+    // bias, log length and the frequency features
+    float weights[SURROGATE_CNT];
+};
+
+#endif
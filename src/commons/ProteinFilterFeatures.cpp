@@ -0,0 +1,114 @@
+#include "ProteinFilterFeatures.h"
+#include "Debug.h"
+#include "Util.h"
+
+#include <algorithm>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+ProteinFilterFeatures::ProteinFilterFeatures(const BaseMatrix &aaMat, const BaseMatrix &reducedMat) {
+    if (aaMat.alphabetSize - 1 != AA_CNT || reducedMat.alphabetSize - 1 != REDUCED_CNT) {
+        Debug(Debug::ERROR) << "Protein filter features need a 20 letter and a reduced 6 letter alphabet\n";
+        EXIT(EXIT_FAILURE);
+    }
+    for (int c = 0; c < 256; c++) {
+        aaIdx[c] = std::min(aaMat.aa2num[c], static_cast<unsigned char>(AA_CNT));
+        reducedIdx[c] = std::min(reducedMat.aa2num[c], static_cast<unsigned char>(REDUCED_CNT));
+    }
+    for (int i = 0; i < 64; i++) {
+        diMask[i] = ((i / 8) < REDUCED_CNT && (i % 8) < REDUCED_CNT) ? 0xffffffff : 0;
+    }
+}
+
+void ProteinFilterFeatures::extract(const char *seq, unsigned int seqLen, float *out) {
+    std::fill(&aaHist[0][0], &aaHist[0][0] + 4 * 32, 0);
+    std::fill(&diHist[0][0], &diHist[0][0] + 4 * 64, 0);
+
+    const unsigned char *residues = reinterpret_cast<const unsigned char *>(seq);
+    if (seqLen > 0) {
+        aaHist[0][aaIdx[residues[0]]]++;
+    }
+    unsigned int prev = (seqLen > 0) ? reducedIdx[residues[0]] : 0;
+    for (unsigned int pos = 1; pos < seqLen; pos++) {
+        const unsigned char c = residues[pos];
+        const unsigned int curr = reducedIdx[c];
+        aaHist[pos & 3][aaIdx[c]]++;
+        diHist[pos & 3][curr * 8 + prev]++;
+        prev = curr;
+    }
+
+    unsigned int aaCnt[32];
+    unsigned int diCnt[64];
+    unsigned int totalAA = 0;
+    unsigned int totalDi = 0;
+#if defined(__GNUC__) && defined(__SSE2__)
+    __m128i aaSum = _mm_setzero_si128();
+    for (int i = 0; i < AA_CNT; i += 4) {
+        __m128i cnt = _mm_add_epi32(_mm_add_epi32(_mm_loadu_si128((const __m128i *) &aaHist[0][i]),
+                                                  _mm_loadu_si128((const __m128i *) &aaHist[1][i])),
+                                    _mm_add_epi32(_mm_loadu_si128((const __m128i *) &aaHist[2][i]),
+                                                  _mm_loadu_si128((const __m128i *) &aaHist[3][i])));
+        _mm_storeu_si128((__m128i *) &aaCnt[i], cnt);
+        aaSum = _mm_add_epi32(aaSum, cnt);
+    }
+    __m128i diSum = _mm_setzero_si128();
+    for (int i = 0; i < 64; i += 4) {
+        __m128i cnt = _mm_add_epi32(_mm_add_epi32(_mm_loadu_si128((const __m128i *) &diHist[0][i]),
+                                                  _mm_loadu_si128((const __m128i *) &diHist[1][i])),
+                                    _mm_add_epi32(_mm_loadu_si128((const __m128i *) &diHist[2][i]),
+                                                  _mm_loadu_si128((const __m128i *) &diHist[3][i])));
+        cnt = _mm_and_si128(cnt, _mm_loadu_si128((const __m128i *) &diMask[i]));
+        _mm_storeu_si128((__m128i *) &diCnt[i], cnt);
+        diSum = _mm_add_epi32(diSum, cnt);
+    }
+    aaSum = _mm_add_epi32(aaSum, _mm_shuffle_epi32(aaSum, 0x4E));
+    aaSum = _mm_add_epi32(aaSum, _mm_shuffle_epi32(aaSum, 0xB1));
+    totalAA = static_cast<unsigned int>(_mm_cvtsi128_si32(aaSum));
+    diSum = _mm_add_epi32(diSum, _mm_shuffle_epi32(diSum, 0x4E));
+    diSum = _mm_add_epi32(diSum, _mm_shuffle_epi32(diSum, 0xB1));
+    totalDi = static_cast<unsigned int>(_mm_cvtsi128_si32(diSum));
+#else
+    for (int i = 0; i < AA_CNT; i++) {
+        aaCnt[i] = aaHist[0][i] + aaHist[1][i] + aaHist[2][i] + aaHist[3][i];
+        totalAA += aaCnt[i];
+    }
+    for (int i = 0; i < 64; i++) {
+        diCnt[i] = (diHist[0][i] + diHist[1][i] + diHist[2][i] + diHist[3][i]) & diMask[i];
+        totalDi += diCnt[i];
+    }
+#endif
+
+    // same float operations as counting with pseudo counts in floats
+    const float aaNorm = static_cast<float>(totalAA) + AA_CNT;
+    const float diNorm = static_cast<float>(totalDi) + REDUCED_CNT * REDUCED_CNT;
+    float diFreq[64];
+    out[0] = static_cast<float>(seqLen);
+#if defined(__GNUC__) && defined(__SSE2__)
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128 aaNormVec = _mm_set1_ps(aaNorm);
+    for (int i = 0; i < AA_CNT; i += 4) {
+        __m128 cnt = _mm_cvtepi32_ps(_mm_add_epi32(_mm_loadu_si128((const __m128i *) &aaCnt[i]), one));
+        _mm_storeu_ps(out + 1 + i, _mm_div_ps(cnt, aaNormVec));
+    }
+    const __m128 diNormVec = _mm_set1_ps(diNorm);
+    for (int i = 0; i < 64; i += 4) {
+        __m128 cnt = _mm_cvtepi32_ps(_mm_add_epi32(_mm_loadu_si128((const __m128i *) &diCnt[i]), one));
+        _mm_storeu_ps(diFreq + i, _mm_div_ps(cnt, diNormVec));
+    }
+#else
+    for (int i = 0; i < AA_CNT; i++) {
+        out[1 + i] = static_cast<float>(aaCnt[i] + 1) / aaNorm;
+    }
+    for (int i = 0; i < 64; i++) {
+        diFreq[i] = static_cast<float>(diCnt[i] + 1) / diNorm;
+    }
+#endif
+    float *diOut = out + 1 + AA_CNT;
+    for (int second = 0; second < REDUCED_CNT; second++) {
+        for (int first = 0; first < REDUCED_CNT; first++) {
+            *(diOut++) = diFreq[second * 8 + first];
+        }
+    }
+}
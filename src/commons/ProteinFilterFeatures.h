@@ -0,0 +1,35 @@
+#ifndef PROTEINFILTERFEATURES_H
+#define PROTEINFILTERFEATURES_H
+
+#include "BaseMatrix.h"
+
+#include <cstddef>
+
+// Input features of the coding protein filter: length, 20 amino acid and
+// 36 reduced (7 letter alphabet without X) dipeptide frequencies, all with
+// a pseudo count of one. The sequence is read once, both histograms are
+// filled in the same pass.
+class ProteinFilterFeatures {
+public:
+    static const int AA_CNT = 20;
+    static const int REDUCED_CNT = 6;
+    static const int FEATURE_CNT = 1 + AA_CNT + REDUCED_CNT * REDUCED_CNT;
+
+    ProteinFilterFeatures(const BaseMatrix &aaMat, const BaseMatrix &reducedMat);
+
+    // writes FEATURE_CNT features to out
+    void extract(const char *seq, unsigned int seqLen, float *out);
+
+private:
+    // lookup from residue to amino acid index and reduced letter (X as 6)
+    unsigned char aaIdx[256];
+    unsigned char reducedIdx[256];
+    // 0xffffffff for dipeptides without X (rows: second residue, cols: first)
+    unsigned int diMask[64];
+
+    // 4 interleaved sub histograms break the store to load dependency on repeats
+    unsigned int aaHist[4][32];
+    unsigned int diHist[4][64];
+};
+
+#endif
@@ -0,0 +1,56 @@
+#include "ReadPairMerger.h"
+
+#include <cstdlib>
+#include <cstring>
+
+size_t readBatch(KSeqWrapper *kseq, std::vector<ReadEntry> &batch, size_t maxCnt) {
+    if (batch.size() < maxCnt) {
+        batch.resize(maxCnt);
+    }
+    size_t cnt = 0;
+    while (cnt < maxCnt && kseq->ReadEntry()) {
+        const KSeqWrapper::KSeqEntry &e = kseq->entry;
+        batch[cnt].name.assign(e.name.s, e.name.l);
+        batch[cnt].seq.assign(e.sequence.s, e.sequence.l);
+        batch[cnt].qual.assign(e.qual.s, e.qual.l);
+        cnt++;
+    }
+    return cnt;
+}
+
+ReadPairMerger::ReadPairMerger() {
+    params.max_overlap = 65;
+    params.min_overlap = 15;
+    params.max_mismatch_density = 0.10;
+    params.cap_mismatch_quals = false;
+    params.allow_outies = false;
+}
+
+void ReadPairMerger::merge(std::vector<ReadEntry> &mates1, std::vector<ReadEntry> &mates2, std::vector<MergedPair> &merged,
+                           size_t start, size_t end) const {
+    struct read r1;
+    struct read r2;
+    struct read rCombined;
+    memset(&r1, 0, sizeof(struct read));
+    memset(&r2, 0, sizeof(struct read));
+    memset(&rCombined, 0, sizeof(struct read));
+    for (size_t i = start; i < end; i++) {
+        r1.seq = &mates1[i].seq[0];
+        r1.seq_len = mates1[i].seq.size();
+        r1.qual = &mates1[i].qual[0];
+        r1.qual_len = mates1[i].qual.size();
+
+        r2.seq = &mates2[i].seq[0];
+        r2.seq_len = mates2[i].seq.size();
+        r2.qual = &mates2[i].qual[0];
+        r2.qual_len = mates2[i].qual.size();
+        // in place, NOT_COMBINED keeps the reverse complement of the second mate
+        reverse_complement(&r2);
+        merged[i].status = combine_reads(&r1, &r2, &rCombined, &params);
+        if (merged[i].status != NOT_COMBINED) {
+            merged[i].seq.assign(rCombined.seq, rCombined.seq_len);
+        }
+    }
+    free(rCombined.seq);
+    free(rCombined.qual);
+}
@@ -0,0 +1,38 @@
+#ifndef READPAIRMERGER_H
+#define READPAIRMERGER_H
+
+#include "KSeqWrapper.h"
+#include <flash/combine_reads.h>
+
+#include <string>
+#include <vector>
+
+struct ReadEntry {
+    std::string name;
+    std::string seq;
+    std::string qual;
+};
+
+// merge result of one read pair, NOT_COMBINED pairs keep both mates
+struct MergedPair {
+    enum combine_status status;
+    std::string seq;
+};
+
+// reads up to maxCnt entries into batch, returns the number of entries read
+size_t readBatch(KSeqWrapper *kseq, std::vector<ReadEntry> &batch, size_t maxCnt);
+
+// Merges overlapping read pairs with FLASH, used by mergereads and readorfs
+class ReadPairMerger {
+public:
+    ReadPairMerger();
+
+    // merges the pairs [start, end), the second mates are reverse complemented in place
+    void merge(std::vector<ReadEntry> &mates1, std::vector<ReadEntry> &mates2, std::vector<MergedPair> &merged,
+               size_t start, size_t end) const;
+
+private:
+    combine_params params;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include "StepCache.h"
+#include "Debug.h"
+#include "FileUtil.h"
+#include "Util.h"
+
+#include <cstdlib>
+#include <sys/stat.h>
+
+// size and modification time, a DB regenerated at the same path usually has the same sizes
+static std::string fileStamp(const std::string &file) {
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0) {
+        Debug(Debug::ERROR) << "Could not stat " << file << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    return SSTR(static_cast<size_t>(st.st_size)) + ":" + SSTR(static_cast<long long>(st.st_mtime));
+}
+
+std::string StepCache::createCacheDirectory(const std::string &cacheDir) {
+    if (FileUtil::directoryExists(cacheDir.c_str()) == false && FileUtil::makeDir(cacheDir.c_str()) == false) {
+        Debug(Debug::ERROR) << "Could not create step cache directory " << cacheDir << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    char *p = realpath(cacheDir.c_str(), NULL);
+    if (p == NULL) {
+        Debug(Debug::ERROR) << "Could not get real path of " << cacheDir << "!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    std::string path(p);
+    free(p);
+    return path;
+}
+
+std::string StepCache::inputKey(LocalParameters &par, const std::string &db) {
+    char *p = realpath(db.c_str(), NULL);
+    if (p == NULL) {
+        Debug(Debug::ERROR) << "Could not get real path of " << db << "!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    std::vector<std::string> parts;
+    parts.push_back(p);
+    free(p);
+
+    std::vector<std::string> dataFiles = FileUtil::findDatafiles(db.c_str());
+    for (size_t i = 0; i < dataFiles.size(); i++) {
+        parts.push_back(fileStamp(dataFiles[i]));
+    }
+    parts.push_back(fileStamp(db + ".index"));
+
+    std::vector<MMseqsParameter*> noParameters;
+    return SSTR(par.hashParameter(parts, noParameters));
+}
+
+std::string StepCache::keyParameters(LocalParameters &par, const std::vector<MMseqsParameter*> &params) {
+    std::vector<MMseqsParameter*> keyParams = par.removeParameter(params, par.PARAM_THREADS);
+    keyParams = par.removeParameter(keyParams, par.PARAM_V);
+    return par.createParameterString(keyParams);
+}
+
+std::string StepCache::stepKey(LocalParameters &par, const std::string &parentKey, const std::string &step,
+                               const std::string &keyParameters) {
+    std::vector<std::string> parts;
+    parts.push_back(parentKey);
+    parts.push_back(step);
+    parts.push_back(keyParameters);
+    std::vector<MMseqsParameter*> noParameters;
+    return SSTR(par.hashParameter(parts, noParameters));
+}
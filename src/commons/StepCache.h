@@ -0,0 +1,28 @@
+#ifndef STEPCACHE_H
+#define STEPCACHE_H
+
+#include "LocalParameters.h"
+
+#include <string>
+#include <vector>
+
+// Keys of the workflow step cache (--step-cache). A step key hashes the key of the step it
+// reads from, the step name and the parameters that change its output, so a changed
+// parameter only invalidates its own step and the steps downstream of it. The workflow
+// scripts keep the output of each step in <cache>/<key>/ and skip steps that are done there.
+class StepCache {
+public:
+    // creates the cache directory, returns its real path
+    static std::string createCacheDirectory(const std::string &cacheDir);
+
+    // key of a workflow input DB, changes if the DB is replaced, by the size and modification time of its files
+    static std::string inputKey(LocalParameters &par, const std::string &db);
+
+    // parameter string of params without threads and verbosity, which do not change the output
+    static std::string keyParameters(LocalParameters &par, const std::vector<MMseqsParameter*> &params);
+
+    static std::string stepKey(LocalParameters &par, const std::string &parentKey, const std::string &step,
+                               const std::string &keyParameters);
+};
+
+#endif
@@ -75,27 +75,47 @@ std::vector<struct Command> commands = {
                                  {"nuclAlnResult", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::alignmentDb },
                                  {"nuclAssembly", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::nuclDb },
                                  {"aaAssembly", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::aaDb }}},
-        {"findassemblystart",    findassemblystart,    &localPar.onlythreads,          COMMAND_HIDDEN,
-                "Compute consensus based new * stop before M amino acid",
+        {"findassemblystart",    findassemblystart,    &localPar.rescorediagonal,          COMMAND_HIDDEN,
+                "Compute consensus based new * stop before M amino acid. The output links the data files of the input sequenceDB, which has to stay in place",
                 NULL,
                 "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
-                "<i:sequenceDB> <i:alnResult> <o:sequenceDB>",
+                "<i:sequenceDB> <i:alnResult> <o:sequenceDB> [<o:alnResult>]",
                 CITATION_PLASS, {{"sequenceDB",  DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
                                  {"alnResult", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::alignmentDb  },
                                  {"sequenceDB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::sequenceDb }}},
         {"filternoncoding",      filternoncoding,      &localPar.filternoncoding,          COMMAND_HIDDEN,
-                "Filter non-coding protein sequences",
+                "Filter non-coding protein sequences. The output links the data files of the input sequenceDB, which has to stay in place",
                 NULL,
                 "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
                 "<i:sequenceDB> <o:sequenceDB>",
                 CITATION_PLASS, {{"sequenceDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
                                  {"sequenceDB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::sequenceDb }}},
+        {"selectbyscore",      selectbyscore,      &localPar.selectbyscore,          COMMAND_HIDDEN,
+                "Select protein sequences by stored protein filter scores for one or more thresholds",
+                NULL,
+                "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
+                "<i:sequenceDB> <i:scoreDB> <o:sequenceDB>",
+                CITATION_PLASS, {{"sequenceDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
+                                 {"scoreDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::genericDb },
+                                 {"sequenceDB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::sequenceDb }}},
+        {"benchmarkfilter",      benchmarkfilter,      &localPar.benchmarkfilter,          COMMAND_HIDDEN,
+                "Report throughput and agreement of a protein filter model with a reference model",
+                NULL,
+                "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
+                "<i:sequenceDB>",
+                CITATION_PLASS, {{"sequenceDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb }}},
         {"mergereads",      mergereads,      &localPar.onlythreads,          COMMAND_HIDDEN,
                 "Merge paired-end reads from FASTQ file (powered by FLASH)",
                 NULL,
                 "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
                 "<i:fastaFile1[.gz]> ... <i:fastaFileN[.gz]> <o:sequenceDB>",
                 CITATION_PLASS, {{"",DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, NULL}}},
+        {"readorfs",      readorfs,      &localPar.readorfs,          COMMAND_HIDDEN,
+                "Extract and translate the ORFs of the assembly workflow directly from (paired-end) read files",
+                NULL,
+                "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
+                "<i:fast(a|q)File1[.gz]> ... <i:fast(a|q)FileN[.gz]> <o:sequenceDB>",
+                CITATION_PLASS, {{"",DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, NULL}}},
         {"cyclecheck",      cyclecheck,      &localPar.cyclecheck,          COMMAND_HIDDEN,
                 "Simple cycle detector",
                 NULL,
@@ -108,5 +128,31 @@ std::vector<struct Command> commands = {
                 NULL,
                 "Annika Seidel <annika.seidel@mpibpc.mpg.de>",
                 "<i:sequenceDB> [<i:sequenceDBcycle>] <o:headerDB>",
-                CITATION_PLASS, {{"sequenceDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, NULL}}}
+                CITATION_PLASS, {{"sequenceDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, NULL}}},
+        {"virtualconcatdbs",      virtualconcatdbs,      &localPar.virtualconcatdbs,          COMMAND_HIDDEN,
+                "Concatenate databases by linking their data files instead of copying them",
+                NULL,
+                "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
+                "<i:DB1> ... <i:DBN> <o:DB>",
+                CITATION_PLASS, {{"",DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, NULL}}},
+        {"selectentries",      selectentries,      &localPar.selectentries,          COMMAND_HIDDEN,
+                "Select index entries by length, key membership and complete protein predicates",
+                NULL,
+                "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
+                "<i:DB> <o:indexFile>",
+                CITATION_PLASS, {{"DB",  DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::allDb },
+                                 {"indexFile", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::flatfile }}},
+        {"filterabsorbed",      filterabsorbed,      &localPar.filterabsorbed,          COMMAND_HIDDEN,
+                "Remove reads covered by ORFs absorbed by hybridassembleresults contigs",
+                NULL,
+                "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
+                "<i:sequenceDB> <i:orfHeaderDB> <i:absorbedDB1> ... <i:absorbedDBN> <o:sequenceDB>",
+                CITATION_PLASS, {{"", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, 0}}},
+        {"maskinterior",      maskinterior,      &localPar.maskinterior,          COMMAND_HIDDEN,
+                "Mask the interior of long sequences to sample k-mers only near their ends. The output links the data files of the input sequenceDB, which has to stay in place",
+                NULL,
+                "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
+                "<i:sequenceDB> <o:sequenceDB>",
+                CITATION_PLASS, {{"sequenceDB",  DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
+                                 {"sequenceDB",  DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::sequenceDb }}}
 };
@@ -0,0 +1,68 @@
+#include "DBReader.h"
+#include "Debug.h"
+#include "Util.h"
+#include "LocalParameters.h"
+#include "OverlayDBWriter.h"
+
+#include <algorithm>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+// Replaces all residues of a sequence except the first and last --kmer-end-window residues by X.
+// This relies on kmermatcher (MMseqs2) skipping k-mers that contain X, then its --kmer-per-seq
+// k-mers of long contigs are all drawn from the ends, where an overlap that extends the contig has
+// to start. If X k-mers were sampled, the masked interior would only lose matches. The positions are
+// unchanged, so the diagonals of the result refer to the unmasked sequences for rescorediagonal.
+// Only masked sequences are written, all others are linked from <i:sequenceDB>.
+int maskinterior(int argc, const char **argv, const Command& command) {
+    LocalParameters &par = LocalParameters::getLocalInstance();
+    par.parseParameters(argc, argv, command, true, 0, 0);
+
+    if (par.kmerEndWindow <= 0) {
+        Debug(Debug::ERROR) << "--kmer-end-window has to be larger than 0\n";
+        EXIT(EXIT_FAILURE);
+    }
+    const size_t window = static_cast<size_t>(par.kmerEndWindow);
+
+    DBReader<unsigned int> reader(par.db1.c_str(), par.db1Index.c_str(), par.threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
+    reader.open(DBReader<unsigned int>::NOSORT);
+
+    OverlayDBWriter::checkCompression(par.PARAM_COMPRESSED.wasSet, par.compressed, reader);
+    OverlayDBWriter writer(reader, par.db2.c_str(), par.db2Index.c_str(), par.threads, reader.getDbtype());
+    writer.open();
+
+    size_t maskedCnt = 0;
+    size_t maskedResidues = 0;
+#pragma omp parallel
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = (unsigned int) omp_get_thread_num();
+#endif
+        std::string seq;
+
+#pragma omp for schedule(dynamic, 100) reduction(+:maskedCnt, maskedResidues)
+        for (size_t id = 0; id < reader.getSize(); id++) {
+            const size_t seqLen = reader.getSeqLen(id);
+            if (seqLen <= 2 * window) {
+                continue;
+            }
+            const char *data = reader.getData(id, thread_idx);
+            seq.assign(data, seqLen);
+            std::fill(seq.begin() + window, seq.end() - window, 'X');
+            seq.push_back('\n');
+            writer.writeData(seq.c_str(), seq.size(), reader.getDbKey(id), thread_idx);
+            maskedCnt++;
+            maskedResidues += seqLen - 2 * window;
+        }
+    }
+    writer.close();
+
+    Debug(Debug::INFO) << "Masked " << maskedResidues << " residues in the interior of " << maskedCnt << " out of " << reader.getSize() << " sequences\n";
+
+    reader.close();
+
+    return EXIT_SUCCESS;
+}
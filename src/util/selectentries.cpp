@@ -0,0 +1,142 @@
+#include "DBReader.h"
+#include "Debug.h"
+#include "Util.h"
+#include "LocalParameters.h"
+
+#include <cstdio>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+// a complete protein has a * at start and end and only upper case residues in between
+static bool isCompleteOrf(const char *data, size_t seqLen) {
+    if (seqLen < 2 || data[0] != '*' || data[seqLen - 1] != '*') {
+        return false;
+    }
+    for (size_t i = 1; i < seqLen - 1; i++) {
+        if (data[i] < 'A' || data[i] > 'Z') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static DBReader<unsigned int> *openIndexOnly(const std::string &db) {
+    DBReader<unsigned int> *reader = new DBReader<unsigned int>(db.c_str(), (db + ".index").c_str(), 1, DBReader<unsigned int>::USE_INDEX);
+    reader->open(DBReader<unsigned int>::NOSORT);
+    return reader;
+}
+
+// Writes the index entries of <i:DB> that fulfill the given predicates to <o:indexFile>, with
+// the offsets into the data of <i:DB>. The result can be passed to createsubdb or linked to the
+// data of <i:DB>. Predicates are combined by AND, or by OR with --match-any.
+int selectentries(int argc, const char **argv, const Command& command) {
+    LocalParameters &par = LocalParameters::getLocalInstance();
+    par.parseParameters(argc, argv, command, true, 0, 0);
+
+    const bool selectGrown = par.selectGrownFrom.empty() == false;
+    const bool selectMembers = par.selectMemberOf.empty() == false;
+    const bool selectNonMembers = par.selectNotMemberOf.empty() == false;
+    const bool selectMinLength = par.selectMinLength > 0;
+    const bool selectComplete = par.selectCompleteOrf;
+    if ((selectGrown || selectMembers || selectNonMembers || selectMinLength || selectComplete) == false) {
+        Debug(Debug::ERROR) << "No selection predicate given\n";
+        EXIT(EXIT_FAILURE);
+    }
+    const bool matchAny = par.selectMatchAny;
+
+    int mode = DBReader<unsigned int>::USE_INDEX;
+    if (selectComplete) {
+        mode |= DBReader<unsigned int>::USE_DATA;
+    }
+    DBReader<unsigned int> reader(par.db1.c_str(), par.db1Index.c_str(), par.threads, mode);
+    reader.open(DBReader<unsigned int>::NOSORT);
+
+    DBReader<unsigned int> *sourceDbr = selectGrown ? openIndexOnly(par.selectGrownFrom) : NULL;
+    DBReader<unsigned int> *memberDbr = selectMembers ? openIndexOnly(par.selectMemberOf) : NULL;
+    DBReader<unsigned int> *nonMemberDbr = selectNonMembers ? openIndexOnly(par.selectNotMemberOf) : NULL;
+
+    std::vector<char> selected(reader.getSize(), 0);
+#pragma omp parallel
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = (unsigned int) omp_get_thread_num();
+#endif
+
+#pragma omp for schedule(dynamic, 10000)
+        for (size_t id = 0; id < reader.getSize(); id++) {
+            const unsigned int key = reader.getDbKey(id);
+            const size_t entryLen = reader.getEntryLen(id);
+            bool anyMatch = false;
+            bool allMatch = true;
+            if (selectGrown) {
+                // same as comparing the index lengths, entries missing in the source are not grown
+                size_t sourceId = sourceDbr->getId(key);
+                bool match = sourceId != UINT_MAX && entryLen > sourceDbr->getEntryLen(sourceId);
+                anyMatch |= match;
+                allMatch &= match;
+            }
+            if (selectMinLength) {
+                bool match = reader.getSeqLen(id) >= static_cast<size_t>(par.selectMinLength);
+                anyMatch |= match;
+                allMatch &= match;
+            }
+            if (selectMembers) {
+                bool match = memberDbr->getId(key) != UINT_MAX;
+                anyMatch |= match;
+                allMatch &= match;
+            }
+            if (selectNonMembers) {
+                bool match = nonMemberDbr->getId(key) == UINT_MAX;
+                anyMatch |= match;
+                allMatch &= match;
+            }
+            if (selectComplete && (matchAny ? anyMatch == false : allMatch)) {
+                bool match = isCompleteOrf(reader.getData(id, thread_idx), reader.getSeqLen(id));
+                anyMatch |= match;
+                allMatch &= match;
+            }
+            selected[id] = matchAny ? anyMatch : allMatch;
+        }
+    }
+
+    // write to a temporary file first, the workflows skip this step if the index exists
+    std::string outIndex = par.db2;
+    std::string tmpIndex = outIndex + ".tmp";
+    FILE *out = fopen(tmpIndex.c_str(), "w");
+    if (out == NULL) {
+        Debug(Debug::ERROR) << "Could not write " << tmpIndex << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    size_t selectedCnt = 0;
+    for (size_t id = 0; id < reader.getSize(); id++) {
+        if (selected[id]) {
+            fprintf(out, "%u\t%zu\t%zu\n", reader.getDbKey(id), reader.getOffset(id), reader.getEntryLen(id));
+            selectedCnt++;
+        }
+    }
+    if (fclose(out) != 0 || std::rename(tmpIndex.c_str(), outIndex.c_str()) != 0) {
+        Debug(Debug::ERROR) << "Could not write " << outIndex << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    Debug(Debug::INFO) << selectedCnt << " out of " << reader.getSize() << " entries selected\n";
+
+    if (nonMemberDbr != NULL) {
+        nonMemberDbr->close();
+        delete nonMemberDbr;
+    }
+    if (memberDbr != NULL) {
+        memberDbr->close();
+        delete memberDbr;
+    }
+    if (sourceDbr != NULL) {
+        sourceDbr->close();
+        delete sourceDbr;
+    }
+    reader.close();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+#include "DBReader.h"
+#include "Debug.h"
+#include "FileUtil.h"
+#include "Util.h"
+#include "LocalParameters.h"
+#include "OverlayDBWriter.h"
+
+#include <algorithm>
+#include <cstdio>
+
+struct VirtualIndexEntry {
+    unsigned int key;
+    size_t offset;
+    size_t length;
+
+    static bool compareByKey(const VirtualIndexEntry &a, const VirtualIndexEntry &b) {
+        return a.key < b.key;
+    }
+};
+
+// Concatenates databases without copying their data: the data files of all inputs are
+// symlinked in order as the data files <o:DB>.0 ... <o:DB>.n of a multi-file database, whose
+// offsets DBReader resolves globally over all files. Only the index is written, with the
+// offsets of later inputs shifted and keys renumbered as concatdbs does (or kept with
+// --preserve-keys). The inputs have to stay in place as long as the output is in use.
+int virtualconcatdbs(int argn, const char **argv, const Command& command) {
+    LocalParameters& par = LocalParameters::getLocalInstance();
+    par.parseParameters(argn, argv, command, true, Parameters::PARSE_VARIADIC, 0);
+
+    std::vector<std::string> inputs(par.filenames);
+    std::string outDb = inputs.back();
+    inputs.pop_back();
+
+    // remove data files of an earlier run
+    OverlayDBWriter::removeDatafiles(outDb);
+
+    std::vector<VirtualIndexEntry> entries;
+    int dbtype = -1;
+    bool compressed = false;
+    size_t dataOffset = 0;
+    size_t linkCnt = 0;
+    unsigned int keyOffset = 0;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        DBReader<unsigned int> reader(inputs[i].c_str(), (inputs[i] + ".index").c_str(), 1, DBReader<unsigned int>::USE_INDEX);
+        reader.open(DBReader<unsigned int>::NOSORT);
+        if (i == 0) {
+            OverlayDBWriter::checkCompression(par.PARAM_COMPRESSED.wasSet, par.compressed, reader);
+            dbtype = reader.getDbtype();
+            compressed = reader.isCompressed();
+        } else if (Parameters::isEqualDbtype(dbtype, reader.getDbtype()) == false || compressed != reader.isCompressed()) {
+            Debug(Debug::ERROR) << "Database " << inputs[i] << " has a different type or compression than " << inputs[0] << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+
+        for (size_t id = 0; id < reader.getSize(); id++) {
+            VirtualIndexEntry entry;
+            entry.key = par.preserveKeys ? reader.getDbKey(id) : (keyOffset + id);
+            entry.offset = dataOffset + reader.getOffset(id);
+            entry.length = reader.getEntryLen(id);
+            entries.push_back(entry);
+        }
+        keyOffset += reader.getSize();
+        reader.close();
+
+        dataOffset += OverlayDBWriter::linkDatafiles(inputs[i], outDb, linkCnt);
+    }
+
+    std::stable_sort(entries.begin(), entries.end(), VirtualIndexEntry::compareByKey);
+    std::string outIndex = outDb + ".index";
+    FILE *out = fopen(outIndex.c_str(), "w");
+    if (out == NULL) {
+        Debug(Debug::ERROR) << "Could not write " << outIndex << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < entries.size(); i++) {
+        fprintf(out, "%u\t%zu\t%zu\n", entries[i].key, entries[i].offset, entries[i].length);
+    }
+    fclose(out);
+
+    // the dbtype file is written last, the workflows check it to skip finished steps
+    FileUtil::copyFile((inputs[0] + ".dbtype").c_str(), (outDb + ".dbtype").c_str());
+
+    Debug(Debug::INFO) << "Linked " << entries.size() << " entries of " << inputs.size() << " databases in " << linkCnt << " data files\n";
+
+    return EXIT_SUCCESS;
+}
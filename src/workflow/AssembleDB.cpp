@@ -4,6 +4,7 @@
 #include "Debug.h"
 #include "FileUtil.h"
 #include "LocalParameters.h"
+#include "StepCache.h"
 
 #include "assembledb.sh.h"
 
@@ -52,6 +53,17 @@ int assembledb(int argc, const char **argv, const Command &command) {
 
     par.parseParameters(argc, argv, command, true, Parameters::PARSE_VARIADIC, 0);
 
+    // the protein filter of the last iteration runs inside assembleresults, which scores every sequence
+    if (par.filterProteins == 1 && par.proteinFilterCascade) {
+        Debug(Debug::ERROR) << "--protein-filter-cascade is not supported by the protein filter of assembleresults, use --filter-proteins 0 and filternoncoding instead\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    // the end windows only restrict the sampled k-mers, diagonals without an end overlap are pruned by --include-only-extendable
+    if (par.kmerEndWindow > 0 && par.PARAM_INCLUDE_ONLY_EXTENDABLE.wasSet && par.includeOnlyExtendable == false) {
+        Debug(Debug::WARNING) << "--kmer-end-window is used with --include-only-extendable 0, diagonals that can not extend are not pruned\n";
+    }
+
     CommandCaller cmd;
 
     std::string tmpDir = par.filenames.back();
@@ -78,12 +90,29 @@ int assembledb(int argc, const char **argv, const Command &command) {
 
     cmd.addVariable("RUNNER", par.runner.c_str());
     cmd.addVariable("NUM_IT", SSTR(par.numIterations).c_str());
-    cmd.addVariable("PROTEIN_FILTER", par.filterProteins == 1 ? "1" : NULL);
+    // readorfs writes the translated ORFs directly, the ORF extraction is skipped for amino acid input
+    const int inputDbType = FileUtil::parseDbType(par.filenames.back().c_str());
+    const bool orfInput = Parameters::isEqualDbtype(inputDbType, Parameters::DBTYPE_AMINO_ACIDS);
+    cmd.addVariable("ORF_INPUT", orfInput ? "TRUE" : NULL);
+
+    // parameters of the step cache keys, collected as the parameters of the steps are set
+    std::vector<std::string> kmermatcherKeyPar;
+    std::vector<std::string> alnKeyPar;
+    std::vector<std::string> assembleKeyPar;
+    std::string orfKeyPar;
+
+    // per-iteration schedules, e.g. cheaper settings for the many short fragments of early iterations
+    const int kmerSize = par.kmerSize;
+    const int kmersPerSequence = par.kmersPerSequence;
+    const float seqIdThr = par.seqIdThr;
+
     // # 1. Finding exact $k$-mer matches.
 
     for(int i = 0; i < par.numIterations; i++){
         std::string key = "KMERMATCHER"+SSTR(i)+"_PAR";
         par.hashShift = par.hashShift + i % 2;
+        par.kmerSize = LocalParameters::scheduleValue(par.kmerSizeSchedule, i, kmerSize);
+        par.kmersPerSequence = LocalParameters::scheduleValue(par.kmersPerSequenceSchedule, i, kmersPerSequence);
         if(par.PARAM_INCLUDE_ONLY_EXTENDABLE.wasSet == false){
             if (i == 0) {
                 par.includeOnlyExtendable = false;
@@ -92,17 +121,38 @@ int assembledb(int argc, const char **argv, const Command &command) {
             }
         }
         cmd.addVariable(key.c_str(), par.createParameterString(par.kmermatcher).c_str());
+        kmermatcherKeyPar.push_back(StepCache::keyParameters(par, par.kmermatcher));
+        // the first iteration matches the whole ORFs, findassemblystart needs all overlaps
+        if (par.kmerEndWindow > 0 && i > 0) {
+            if (par.kmerEndWindow < par.kmerSize) {
+                Debug(Debug::ERROR) << "--kmer-end-window " << par.kmerEndWindow << " is smaller than the k-mer size " << par.kmerSize << " of iteration " << i << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            cmd.addVariable(("END_WINDOW" + SSTR(i)).c_str(), "TRUE");
+            kmermatcherKeyPar.back().append(StepCache::keyParameters(par, par.maskinterior));
+        }
     }
+    par.kmerSize = kmerSize;
+    par.kmersPerSequence = kmersPerSequence;
 
     cmd.addVariable("KMERMATCHER_PAR", par.createParameterString(par.kmermatcher).c_str());
 
     // # 2. Hamming distance pre-clustering
     par.filterHits = false;
 
+    // the start and long ORF steps of the script run concurrently if both have to be computed,
+    // then each of them uses the *_HALF_PAR parameters with half of the threads
+    const int threads = par.threads;
+    const int halfThreads = std::max(1, (threads + 1) / 2);
+
     // --orf-start-mode 0 --min-length 45 --max-gaps 0
     par.orfStartMode = 0;
     par.orfMaxGaps = 0;
     cmd.addVariable("EXTRACTORFS_LONG_PAR", par.createParameterString(par.extractorfs).c_str());
+    par.threads = halfThreads;
+    cmd.addVariable("EXTRACTORFS_LONG_HALF_PAR", par.createParameterString(par.extractorfs).c_str());
+    par.threads = threads;
+    orfKeyPar.append(StepCache::keyParameters(par, par.extractorfs));
 
 
     // --contig-start-mode 1 --contig-end-mode 0 --orf-start-mode 0 --min-length 30 --max-length 45 --max-gaps 0
@@ -113,15 +163,68 @@ int assembledb(int argc, const char **argv, const Command &command) {
     par.orfMinLength = std::min(par.orfMinLength, 20);
     par.orfMaxGaps = 0;
     cmd.addVariable("EXTRACTORFS_START_PAR", par.createParameterString(par.extractorfs).c_str());
+    par.threads = halfThreads;
+    cmd.addVariable("EXTRACTORFS_START_HALF_PAR", par.createParameterString(par.extractorfs).c_str());
+    par.threads = threads;
+    orfKeyPar.append(StepCache::keyParameters(par, par.extractorfs));
 
 
     par.addOrfStop = true;
     //cmd.addVariable("CREATEDB_PAR", par.createParameterString(par.createdb).c_str());
     cmd.addVariable("TRANSLATENUCS_PAR", par.createParameterString(par.translatenucs).c_str());
+    par.threads = halfThreads;
+    cmd.addVariable("TRANSLATENUCS_HALF_PAR", par.createParameterString(par.translatenucs).c_str());
+    par.threads = threads;
+    orfKeyPar.append(StepCache::keyParameters(par, par.translatenucs));
+    for (int i = 0; i < par.numIterations; i++) {
+        std::string key = "UNGAPPED_ALN" + SSTR(i) + "_PAR";
+        par.seqIdThr = LocalParameters::scheduleValue(par.seqIdSchedule, i, seqIdThr);
+        cmd.addVariable(key.c_str(), par.createParameterString(par.rescorediagonal).c_str());
+        alnKeyPar.push_back(StepCache::keyParameters(par, par.rescorediagonal));
+    }
+    par.seqIdThr = seqIdThr;
     cmd.addVariable("UNGAPPED_ALN_PAR", par.createParameterString(par.rescorediagonal).c_str());
+    // prune non-coding fragments only after selected iterations, the last iteration runs the protein filter
+    const float pruneThreshold = par.pruneThreshold;
+    for (int i = 0; i < par.numIterations; i++) {
+        std::string key = "ASSEMBLE_RESULT" + SSTR(i) + "_PAR";
+        const bool lastIteration = (i == par.numIterations - 1);
+        const bool pruneIteration = (i + 1) % par.pruneEvery == 0 && lastIteration == false;
+        par.pruneThreshold = pruneIteration ? pruneThreshold : 0.0f;
+        par.filterAssembly = (par.filterProteins == 1 && lastIteration) ? 1 : 0;
+        par.seqIdThr = LocalParameters::scheduleValue(par.seqIdSchedule, i, seqIdThr);
+        cmd.addVariable(key.c_str(), par.createParameterString(par.assembleresults).c_str());
+        assembleKeyPar.push_back(StepCache::keyParameters(par, par.assembleresults));
+    }
+    par.seqIdThr = seqIdThr;
+    par.pruneThreshold = 0.0f;
+    par.filterAssembly = 0;
+
     cmd.addVariable("ASSEMBLE_RESULT_PAR", par.createParameterString(par.assembleresults).c_str());
-    cmd.addVariable("FILTERNONCODING_PAR", par.createParameterString(par.filternoncoding).c_str());
 
+    if (par.stepCache.empty() == false) {
+        cmd.addVariable("CACHE_PATH", StepCache::createCacheDirectory(par.stepCache).c_str());
+        // changing late parameters (e.g. the protein filter of the last iteration) keeps the keys of earlier steps
+        std::string key = StepCache::inputKey(par, par.filenames.back());
+        if (orfInput == false) {
+            key = StepCache::stepKey(par, key, "orfs", orfKeyPar);
+            cmd.addVariable("ORFS_KEY", key.c_str());
+        }
+        for (int i = 0; i < par.numIterations; i++) {
+            key = StepCache::stepKey(par, key, "kmermatcher", kmermatcherKeyPar[i]);
+            cmd.addVariable(("PREF" + SSTR(i) + "_KEY").c_str(), key.c_str());
+            key = StepCache::stepKey(par, key, "rescorediagonal", alnKeyPar[i]);
+            cmd.addVariable(("ALN" + SSTR(i) + "_KEY").c_str(), key.c_str());
+            if (i == 0) {
+                key = StepCache::stepKey(par, key, "findassemblystart", alnKeyPar[i]);
+                cmd.addVariable("CORRECTED_KEY", key.c_str());
+            }
+            key = StepCache::stepKey(par, key, "assembleresults", assembleKeyPar[i]);
+            cmd.addVariable(("ASSEMBLY" + SSTR(i) + "_KEY").c_str(), key.c_str());
+        }
+    }
+
+    cmd.addVariable("MASKINTERIOR_PAR", par.createParameterString(par.maskinterior).c_str());
     cmd.addVariable("THREADS_PAR", par.createParameterString(par.onlythreads).c_str());
     cmd.addVariable("VERBOSITY_PAR", par.createParameterString(par.onlyverbosity).c_str());
 
@@ -115,6 +115,12 @@ int easyassembler(int argc, const char **argv, const Command &command) {
     cmd.addVariable("ASSEMBLY_MODULE", "assembledb");
     cmd.addVariable("VERBOSITY_PAR", par.createParameterString(par.onlyverbosity).c_str());
 
+    // readorfs replaces mergereads/createdb and the ORF extraction of assembledb, stop codons as in its translatenucs step
+    cmd.addVariable("STREAM_ORFS", par.streamOrfs ? "TRUE" : NULL);
+    par.pairedEnd = (par.filenames.size() % 2 == 0) ? 1 : 0;
+    par.addOrfStop = true;
+    cmd.addVariable("READORFS_PAR", par.createParameterString(par.readorfs).c_str());
+
     std::string program = tmpDir + "/easyassembler.sh";
     FileUtil::writeFile(program, easyassembler_sh, easyassembler_sh_len);
     cmd.execProgram(program.c_str(), par.filenames);
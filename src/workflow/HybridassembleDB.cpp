@@ -4,6 +4,7 @@
 #include "Debug.h"
 #include "FileUtil.h"
 #include "LocalParameters.h"
+#include "StepCache.h"
 
 #include "hybridassembledb.sh.h"
 
@@ -109,10 +110,18 @@ int hybridassembledb(int argc, const char **argv, const Command &command) {
     cmd.addVariable("NUM_IT", SSTR(par.numIterations).c_str());
 
     // # 0. Extract ORFs
+    // both extractorfs calls of the script run concurrently if both have to be computed,
+    // then each of them uses the *_HALF_PAR parameters with half of the threads
+    const int threads = par.threads;
+    const int halfThreads = std::max(1, (threads + 1) / 2);
     // --orf-start-mode 0 --min-length 45 --max-gaps 0
     par.orfStartMode = 0;
     par.orfMaxGaps = 0;
     cmd.addVariable("EXTRACTORFS_LONG_PAR", par.createParameterString(par.extractorfs).c_str());
+    par.threads = halfThreads;
+    cmd.addVariable("EXTRACTORFS_LONG_HALF_PAR", par.createParameterString(par.extractorfs).c_str());
+    par.threads = threads;
+    std::string orfKeyPar = StepCache::keyParameters(par, par.extractorfs);
 
     // --contig-start-mode 1 --contig-end-mode 0 --orf-start-mode 0 --min-length 30 --max-length 45 --max-gaps 0
     par.contigStartMode = 1;
@@ -122,6 +131,10 @@ int hybridassembledb(int argc, const char **argv, const Command &command) {
     par.orfMinLength = std::min(par.orfMinLength, 20);
     par.orfMaxGaps = 0;
     cmd.addVariable("EXTRACTORFS_START_PAR", par.createParameterString(par.extractorfs).c_str());
+    par.threads = halfThreads;
+    cmd.addVariable("EXTRACTORFS_START_HALF_PAR", par.createParameterString(par.extractorfs).c_str());
+    par.threads = threads;
+    orfKeyPar.append(StepCache::keyParameters(par, par.extractorfs));
 
     // force parameters for assembly steps
     par.covThr = 0.0;
@@ -138,7 +151,28 @@ int hybridassembledb(int argc, const char **argv, const Command &command) {
     cmd.addVariable("UNGAPPED_ALN_PAR", par.createParameterString(par.rescorediagonal).c_str());
 
     // # 3. Assembly: Extend by left and right extension
-    cmd.addVariable("ASSEMBLE_RESULT_PAR", par.createParameterString(par.assembleresults).c_str());
+    cmd.addVariable("ASSEMBLE_RESULT_PAR", par.createParameterString(par.hybridassembleresults).c_str());
+    cmd.addVariable("SKIP_ABSORBED_READS", par.skipAbsorbedReads ? "TRUE" : NULL);
+
+    if (par.stepCache.empty() == false) {
+        // the nucleotide assembly receives --step-cache with NUCL_ASM_PAR and keys its own steps
+        cmd.addVariable("CACHE_PATH", StepCache::createCacheDirectory(par.stepCache).c_str());
+        const std::string kmermatcherKeyPar = StepCache::keyParameters(par, par.kmermatcher);
+        const std::string alnKeyPar = StepCache::keyParameters(par, par.rescorediagonal);
+        const std::string assembleKeyPar = StepCache::keyParameters(par, par.hybridassembleresults);
+        std::string key = StepCache::stepKey(par, StepCache::inputKey(par, par.filenames.back()), "orfs", orfKeyPar);
+        cmd.addVariable("ORFS_KEY", key.c_str());
+        for (int i = 0; i < par.numIterations; i++) {
+            key = StepCache::stepKey(par, key, "kmermatcher", kmermatcherKeyPar);
+            cmd.addVariable(("PREF" + SSTR(i) + "_KEY").c_str(), key.c_str());
+            key = StepCache::stepKey(par, key, "rescorediagonal", alnKeyPar);
+            cmd.addVariable(("ALN" + SSTR(i) + "_KEY").c_str(), key.c_str());
+            key = StepCache::stepKey(par, key, "proteinaln2nucl", "");
+            cmd.addVariable(("ALN_NUCL" + SSTR(i) + "_KEY").c_str(), key.c_str());
+            key = StepCache::stepKey(par, key, "hybridassembleresults", assembleKeyPar);
+            cmd.addVariable(("ASSEMBLY" + SSTR(i) + "_KEY").c_str(), key.c_str());
+        }
+    }
 
     // set mandatory values for nucleotide level assembly step when calling nucleassemble from hybridassemble
     par.numIterations = par.multiNumIterations.nucleotides;
@@ -4,6 +4,7 @@
 #include "Debug.h"
 #include "FileUtil.h"
 #include "LocalParameters.h"
+#include "StepCache.h"
 
 #include "nuclassembledb.sh.h"
 
@@ -84,6 +85,24 @@ int nuclassembledb(int argc, const char **argv, const Command &command) {
 
     cmd.addVariable("MIN_CONTIG_LEN", SSTR(par.minContigLen).c_str());
 
+    if (par.stepCache.empty() == false) {
+        cmd.addVariable("CACHE_PATH", StepCache::createCacheDirectory(par.stepCache).c_str());
+        // the cycle check writes next to its assembly and changes the input of the next iteration
+        std::string assembleKeyPar = StepCache::keyParameters(par, par.assembleresults);
+        if (par.cycleCheck) {
+            assembleKeyPar.append(StepCache::keyParameters(par, par.cyclecheck));
+        }
+        std::string key = StepCache::inputKey(par, par.filenames.back());
+        for (int i = 0; i < par.numIterations; i++) {
+            key = StepCache::stepKey(par, key, "kmermatcher", StepCache::keyParameters(par, par.kmermatcher));
+            cmd.addVariable(("PREF" + SSTR(i) + "_KEY").c_str(), key.c_str());
+            key = StepCache::stepKey(par, key, "rescorediagonal", StepCache::keyParameters(par, par.rescorediagonal));
+            cmd.addVariable(("ALN" + SSTR(i) + "_KEY").c_str(), key.c_str());
+            key = StepCache::stepKey(par, key, par.cycleCheck ? "assembleresults_cyclecheck" : "assembleresults", assembleKeyPar);
+            cmd.addVariable(("ASSEMBLY" + SSTR(i) + "_KEY").c_str(), key.c_str());
+        }
+    }
+
     cmd.addVariable("THREADS_PAR", par.createParameterString(par.onlythreads).c_str());
     cmd.addVariable("VERBOSITY_PAR", par.createParameterString(par.onlyverbosity).c_str());
 